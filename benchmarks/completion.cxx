@@ -0,0 +1,75 @@
+/*
+ * Measure time of listing completions in a pseudo terminal
+ * for growing numbers of candidates.
+ *
+ * For each count a session completes a word every candidate starts with,
+ * so nothing can be inserted.  Time is measured until the question
+ * whether to display all of them is shown, which covers collecting
+ * the candidates and finding their common prefix, and then until
+ * the first page of the list is shown.
+ */
+
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+
+#include "replxx.hxx"
+#include "terminal.hxx"
+
+using namespace std;
+using namespace replxx;
+
+namespace {
+
+char const WORD[] = "candidate_";
+
+void complete( Replxx::InputView const&, int, Replxx::Collector& completions_, void* ud_ ) {
+	int count( *static_cast<int*>( ud_ ) );
+	char buf[32];
+	for ( int i( 0 ); i < count; ++ i ) {
+		int len( snprintf( buf, sizeof ( buf ), "%s%d", WORD, ( i * 7919 ) % count ) );
+		completions_.add( buf, len );
+	}
+}
+
+void highlight( Replxx::InputView const& input_, int, int, int, Replxx::colors_t&, void* ) {
+	bench::Terminal::report( input_.length() );
+}
+
+int session( int count_ ) {
+	Replxx replxx;
+	replxx.set_completion_collector_callback( complete, &count_ );
+	replxx.set_incremental_highlighter_view_callback( highlight, nullptr );
+	return ( replxx.input( "bench> " ) != nullptr ? 0 : 1 );
+}
+
+double ms_since( chrono::steady_clock::time_point start_ ) {
+	return ( chrono::duration<double, milli>( chrono::steady_clock::now() - start_ ).count() );
+}
+
+}
+
+int main( int argc_, char** argv_ ) {
+	if ( bench::Terminal::is_session() ) {
+		return ( session( argc_ > 1 ? atoi( argv_[1] ) : 0 ) );
+	}
+	int res( 0 );
+	printf( "%10s %12s %12s\n", "candidates", "question ms", "page ms" );
+	for ( int count : { 1000, 10000, 100000, 200000 } ) {
+		string countArg( to_string( count ) );
+		char* args[] = { argv_[0], &countArg[0], nullptr };
+		bench::Terminal terminal( args, 80, 24 );
+		terminal.type( WORD );
+		chrono::steady_clock::time_point start( chrono::steady_clock::now() );
+		terminal.type_until( "\t", "(y or n)" );
+		double question( ms_since( start ) );
+		start = chrono::steady_clock::now();
+		terminal.type_until( "y", "--More--" );
+		double page( ms_since( start ) );
+		printf( "%10d %12.1f %12.1f\n", count, question, page );
+		res |= terminal.finish( "q\r" );
+	}
+	return ( res );
+}
+
@@ -0,0 +1,185 @@
+/*
+ * Check that SIMD fast paths of UTF-8 <-> UTF-32 conversion give the same
+ * results as plain ConvertUTF routines, then compare their speed.
+ *
+ * Inputs mix runs of ASCII of all lengths around SIMD block sizes
+ * with multi-byte characters, so buffers end at every offset within
+ * a 16 and 32 character block.
+ */
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+#include "conversion.hxx"
+
+using namespace std;
+using namespace replxx;
+
+namespace {
+
+struct Level {
+	SIMD simd;
+	char const* name;
+};
+
+Level const levels[] = {
+	{ SIMD::NONE, "scalar" },
+	{ SIMD::SSE2, "sse2" },
+	{ SIMD::AVX2, "avx2" }
+};
+
+char32_t const multiByte[] = { 0xe9, 0x3b1, 0x20ac, 0x4e2d, 0x1f600 };
+
+u32string make_text( mt19937& rng_, int length_, int asciiPercent_ ) {
+	u32string text;
+	uniform_int_distribution<int> percent( 0, 99 );
+	uniform_int_distribution<int> printable( 0x20, 0x7e );
+	uniform_int_distribution<int> other( 0, static_cast<int>( sizeof ( multiByte ) / sizeof ( multiByte[0] ) ) - 1 );
+	for ( int i( 0 ); i < length_; ++ i ) {
+		text.push_back( percent( rng_ ) < asciiPercent_ ? static_cast<char32_t>( printable( rng_ ) ) : multiByte[other( rng_ )] );
+	}
+	return ( text );
+}
+
+// plain ConvertUTF conversions, the reference
+string reference_8( u32string const& text_ ) {
+	vector<UTF8> buf( text_.length() * 4 + 1 );
+	UTF32 const* src( reinterpret_cast<UTF32 const*>( text_.data() ) );
+	UTF8* dst( buf.data() );
+	ConvertUTF32toUTF8( &src, src + text_.length(), &dst, buf.data() + buf.size(), lenientConversion );
+	return ( string( reinterpret_cast<char*>( buf.data() ), reinterpret_cast<char*>( dst ) ) );
+}
+
+u32string reference_32( string const& text_ ) {
+	vector<UTF32> buf( text_.length() + 1 );
+	UTF8 const* src( reinterpret_cast<UTF8 const*>( text_.data() ) );
+	UTF32* dst( buf.data() );
+	ConvertUTF8toUTF32( &src, src + text_.length(), &dst, buf.data() + buf.size(), lenientConversion );
+	return ( u32string( reinterpret_cast<char32_t*>( buf.data() ), reinterpret_cast<char32_t*>( dst ) ) );
+}
+
+string to_8( u32string const& text_, size_t dstSize_ ) {
+	vector<char> buf( dstSize_ + 1, '\x7f' );
+	size_t count( 0 );
+	copyString32to8( buf.data(), dstSize_, &count, text_.data(), text_.length() );
+	return ( string( buf.data(), count ) + ( count < dstSize_ ? buf[count] : '-' ) );
+}
+
+u32string to_32( string const& text_, size_t dstSize_, ConversionResult& result_ ) {
+	vector<char32_t> buf( dstSize_ + 1, 0x7f );
+	size_t count( 0 );
+	result_ = copyString8to32( buf.data(), dstSize_, count, text_.c_str() );
+	return ( u32string( buf.data(), count ) + ( count < dstSize_ ? buf[count] : U'-' ) );
+}
+
+int check( void ) {
+	mt19937 rng( 1 );
+	int failures( 0 );
+	int cases( 0 );
+	for ( int length( 0 ); length <= 200; ++ length ) {
+		for ( int asciiPercent : { 100, 99, 90, 50, 0 } ) {
+			u32string text( make_text( rng, length, asciiPercent ) );
+			string utf8( reference_8( text ) );
+			if ( reference_32( utf8 ) != text ) {
+				fprintf( stderr, "reference conversion is not reversible\n" );
+				return ( 1 );
+			}
+			// full buffers must match the reference, truncated ones must match the scalar path
+			string expected8[] = { to_8( text, utf8.length() + 1 ), string(), string() };
+			ConversionResult r32( conversionOK );
+			u32string expected32[] = { to_32( utf8, text.length() + 1, r32 ), u32string(), u32string() };
+			size_t shortLength8( utf8.length() / 2 );
+			size_t shortLength32( text.length() / 2 );
+			for ( Level const& level : levels ) {
+				if ( ! use_simd( level.simd ) ) {
+					continue;
+				}
+				string got8( to_8( text, utf8.length() + 1 ) );
+				ConversionResult res( conversionOK );
+				u32string got32( to_32( utf8, text.length() + 1, res ) );
+				bool ok( ( got8 == utf8 + '\0' ) && ( got32 == text + U'\0' ) && ( res == conversionOK ) );
+				if ( level.simd == SIMD::NONE ) {
+					expected8[1] = to_8( text, shortLength8 );
+					expected32[1] = to_32( utf8, shortLength32, r32 );
+					expected8[2] = to_8( text, 16 );
+					expected32[2] = to_32( utf8, 16, r32 );
+				} else {
+					ok = ok
+						&& ( to_8( text, shortLength8 ) == expected8[1] )
+						&& ( to_32( utf8, shortLength32, res ) == expected32[1] )
+						&& ( to_8( text, 16 ) == expected8[2] )
+						&& ( to_32( utf8, 16, res ) == expected32[2] );
+				}
+				++ cases;
+				if ( ! ok ) {
+					fprintf( stderr, "%s: mismatch for %d characters, %d%% ASCII\n", level.name, length, asciiPercent );
+					++ failures;
+				}
+			}
+		}
+	}
+	printf( "conversion checks: %d, failures: %d\n", cases, failures );
+	return ( failures > 0 ? 1 : 0 );
+}
+
+template<typename call_t>
+double throughput( size_t bytes_, call_t call_ ) {
+	int const rounds( 200 );
+	chrono::steady_clock::time_point start( chrono::steady_clock::now() );
+	for ( int i( 0 ); i < rounds; ++ i ) {
+		call_();
+	}
+	double s( chrono::duration<double>( chrono::steady_clock::now() - start ).count() );
+	return ( static_cast<double>( bytes_ ) * rounds / s / 1e6 );
+}
+
+void benchmark( void ) {
+	mt19937 rng( 2 );
+	for ( int asciiPercent : { 100, 99, 90, 50, 0 } ) {
+		u32string text( make_text( rng, 1 << 18, asciiPercent ) );
+		string utf8( reference_8( text ) );
+		vector<char> buf8( utf8.length() + 1 );
+		vector<char32_t> buf32( text.length() + 1 );
+		size_t count( 0 );
+		printf( "%d%% ASCII, UTF-8 MB/s to UTF-32 / from UTF-32:\n", asciiPercent );
+		printf(
+			"  %-10s %8.0f / %8.0f\n", "ConvertUTF",
+			throughput( utf8.length(), [&]() {
+				UTF8 const* src( reinterpret_cast<UTF8 const*>( utf8.data() ) );
+				UTF32* dst( reinterpret_cast<UTF32*>( buf32.data() ) );
+				ConvertUTF8toUTF32( &src, src + utf8.length(), &dst, dst + buf32.size(), lenientConversion );
+			} ),
+			throughput( utf8.length(), [&]() {
+				UTF32 const* src( reinterpret_cast<UTF32 const*>( text.data() ) );
+				UTF8* dst( reinterpret_cast<UTF8*>( buf8.data() ) );
+				ConvertUTF32toUTF8( &src, src + text.length(), &dst, dst + buf8.size(), lenientConversion );
+			} )
+		);
+		for ( Level const& level : levels ) {
+			if ( ! use_simd( level.simd ) ) {
+				continue;
+			}
+			printf(
+				"  %-10s %8.0f / %8.0f\n", level.name,
+				throughput( utf8.length(), [&]() { copyString8to32( buf32.data(), buf32.size(), count, utf8.c_str() ); } ),
+				throughput( utf8.length(), [&]() { copyString32to8( buf8.data(), buf8.size(), &count, text.data(), text.length() ); } )
+			);
+		}
+	}
+}
+
+}
+
+int main( int, char** ) {
+	locale::is8BitEncoding = false;
+	int res( check() );
+	if ( res == 0 ) {
+		benchmark();
+	}
+	return ( res );
+}
+
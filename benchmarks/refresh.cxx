@@ -0,0 +1,98 @@
+/*
+ * Count memory allocations and measure time of screen refreshes
+ * while a line is typed and erased in a pseudo terminal.
+ *
+ * Only the second round of typing is measured, by then all buffers
+ * used for painting have grown to their final size, so a refresh
+ * is expected not to allocate at all.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+
+#include "replxx.hxx"
+#include "terminal.hxx"
+
+using namespace std;
+using namespace replxx;
+
+namespace {
+
+std::atomic<long long> allocations( 0 );
+
+int const LINE_LENGTH( 150 ); // wraps in an 80 columns terminal
+int const ROUND_KEYS( 2 * LINE_LENGTH );
+
+struct Session {
+	int keys;
+	long long allocations;
+	chrono::steady_clock::time_point start;
+	chrono::steady_clock::time_point end;
+};
+
+void highlight( Replxx::InputView const&, int pos_, int, int inserted_, Replxx::colors_t& colors_, void* ud_ ) {
+	Session& s( *static_cast<Session*>( ud_ ) );
+	for ( int i( pos_ ); i < pos_ + inserted_; ++ i ) {
+		colors_[i] = ( i % 2 ) != 0 ? Replxx::Color::BRIGHTGREEN : Replxx::Color::DEFAULT;
+	}
+	++ s.keys;
+	if ( s.keys == ROUND_KEYS ) {
+		s.allocations = allocations;
+		s.start = chrono::steady_clock::now();
+	} else if ( s.keys == 2 * ROUND_KEYS ) {
+		s.allocations = allocations - s.allocations;
+		s.end = chrono::steady_clock::now();
+	}
+	bench::Terminal::report( s.keys );
+}
+
+int session( void ) {
+	Session s = { 0, 0, chrono::steady_clock::time_point(), chrono::steady_clock::time_point() };
+	Replxx replxx;
+	replxx.set_incremental_highlighter_view_callback( highlight, &s );
+	if ( replxx.input( "\x1b[1;32mbench\x1b[0m> " ) == nullptr ) {
+		return ( 1 );
+	}
+	double us( chrono::duration<double, micro>( s.end - s.start ).count() );
+	fprintf(
+		stderr, "refreshes: %d, allocations: %lld (%.3f per refresh), %.1f us per key\n",
+		ROUND_KEYS, s.allocations, static_cast<double>( s.allocations ) / ROUND_KEYS, us / ROUND_KEYS
+	);
+	return ( s.allocations == 0 ? 0 : 1 );
+}
+
+}
+
+void* operator new( size_t size_ ) {
+	++ allocations;
+	void* p( malloc( size_ > 0 ? size_ : 1 ) );
+	if ( ! p ) {
+		throw bad_alloc();
+	}
+	return ( p );
+}
+
+void operator delete( void* p_ ) noexcept {
+	free( p_ );
+}
+
+int main( int, char** argv ) {
+	if ( bench::Terminal::is_session() ) {
+		return ( session() );
+	}
+	bench::Terminal terminal( argv, 80, 24 );
+	string line;
+	for ( int i( 0 ); i < LINE_LENGTH; ++ i ) {
+		line.push_back( static_cast<char>( 'a' + i % 26 ) );
+	}
+	string erase( LINE_LENGTH, '\x7f' );
+	for ( int round( 0 ); round < 2; ++ round ) {
+		terminal.type( line );
+		terminal.type( erase );
+	}
+	return ( terminal.finish( "\r" ) );
+}
+
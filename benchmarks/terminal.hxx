@@ -0,0 +1,172 @@
+#ifndef REPLXX_BENCHMARKS_TERMINAL_HXX_INCLUDED
+#define REPLXX_BENCHMARKS_TERMINAL_HXX_INCLUDED 1
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+
+namespace bench {
+
+/*! \brief Run a benchmark session inside of a pseudo terminal.
+ *
+ * Replxx finds out if standard input and output are terminals when it is loaded,
+ * so the benchmark executable runs itself again with a pseudo terminal
+ * as its standard input and output, while this process types keys into it.
+ *
+ * The session reports its progress, a count of handled keys, on descriptor 3
+ * with report(), type() waits for the report of each key so that every
+ * key is handled, and the screen refreshed, on its own.
+ * Results are printed by the session on standard error, which is inherited.
+ */
+class Terminal {
+	int _master;
+	int _progress;
+	pid_t _session;
+	int _keys;
+public:
+	static int const PROGRESS_FD = 3;
+	/*! \brief Tell if this process is the benchmark session.
+	 */
+	static bool is_session( void ) {
+		return ( getenv( "REPLXX_BENCH_SESSION" ) != nullptr );
+	}
+	/*! \brief Report number of keys handled so far, called by the session.
+	 */
+	static void report( int keys_ ) {
+		static_cast<void>( write( PROGRESS_FD, &keys_, sizeof ( keys_ ) ) >= 0 );
+	}
+	Terminal( char** argv_, int columns_, int rows_ )
+		: _master( -1 )
+		, _progress( -1 )
+		, _session( -1 )
+		, _keys( 0 ) {
+		_master = posix_openpt( O_RDWR | O_NOCTTY );
+		int progress[2];
+		if ( ( _master < 0 ) || ( grantpt( _master ) != 0 ) || ( unlockpt( _master ) != 0 ) || ( pipe( progress ) != 0 ) ) {
+			fail( "cannot create pseudo terminal" );
+		}
+		struct winsize ws = { static_cast<unsigned short>( rows_ ), static_cast<unsigned short>( columns_ ), 0, 0 };
+		ioctl( _master, TIOCSWINSZ, &ws );
+		char const* slaveName( ptsname( _master ) );
+		_session = fork();
+		if ( _session == 0 ) {
+			setsid();
+			int slave( open( slaveName, O_RDWR ) );
+			if ( slave < 0 ) {
+				fail( "cannot open pseudo terminal" );
+			}
+			dup2( slave, 0 );
+			dup2( slave, 1 );
+			dup2( progress[1], PROGRESS_FD );
+			setenv( "REPLXX_BENCH_SESSION", "1", 1 );
+			execv( "/proc/self/exe", argv_ );
+			execvp( argv_[0], argv_ );
+			fail( "cannot run benchmark session" );
+		}
+		close( progress[1] );
+		_progress = progress[0];
+	}
+	~Terminal( void ) {
+		close( _master );
+		close( _progress );
+	}
+	/*! \brief Type keys one at a time, wait until each of them is handled.
+	 */
+	void type( std::string const& keys_ ) {
+		for ( char key : keys_ ) {
+			type_raw( std::string( 1, key ), 1 );
+		}
+	}
+	/*! \brief Type a sequence of bytes that the session handles as given number of keys.
+	 */
+	void type_raw( std::string const& bytes_, int keys_ ) {
+		if ( write( _master, bytes_.data(), bytes_.length() ) != static_cast<ssize_t>( bytes_.length() ) ) {
+			fail( "cannot write to pseudo terminal" );
+		}
+		_keys += keys_;
+		int handled( 0 );
+		while ( handled < _keys ) {
+			pollfd fds[] = { { _master, POLLIN, 0 }, { _progress, POLLIN, 0 } };
+			if ( poll( fds, 2, -1 ) < 0 ) {
+				if ( errno == EINTR ) {
+					continue;
+				}
+				fail( "poll failed" );
+			}
+			drain();
+			if ( fds[1].revents != 0 ) {
+				if ( read( _progress, &handled, sizeof ( handled ) ) != sizeof ( handled ) ) {
+					fail( "benchmark session ended prematurely" );
+				}
+			}
+		}
+	}
+	/*! \brief Type a sequence of bytes, wait until given text appears on the screen.
+	 */
+	void type_until( std::string const& bytes_, std::string const& text_ ) {
+		if ( write( _master, bytes_.data(), bytes_.length() ) != static_cast<ssize_t>( bytes_.length() ) ) {
+			fail( "cannot write to pseudo terminal" );
+		}
+		std::string screen;
+		char buf[65536];
+		while ( screen.find( text_ ) == std::string::npos ) {
+			// only the end of what was shown so far can be a part of the text
+			if ( screen.length() > text_.length() ) {
+				screen.erase( 0, screen.length() - text_.length() );
+			}
+			ssize_t nread( read( _master, buf, sizeof ( buf ) ) );
+			if ( nread <= 0 ) {
+				if ( ( nread < 0 ) && ( errno == EINTR ) ) {
+					continue;
+				}
+				fail( "benchmark session ended prematurely" );
+			}
+			screen.append( buf, static_cast<size_t>( nread ) );
+		}
+	}
+	/*! \brief Type the rest of the session without waiting for each key, wait for the session to end.
+	 *
+	 * \return Exit status of the session.
+	 */
+	int finish( std::string const& bytes_ ) {
+		if ( write( _master, bytes_.data(), bytes_.length() ) != static_cast<ssize_t>( bytes_.length() ) ) {
+			fail( "cannot write to pseudo terminal" );
+		}
+		int status( 0 );
+		while ( waitpid( _session, &status, WNOHANG ) == 0 ) {
+			pollfd fds[] = { { _master, POLLIN, 0 } };
+			if ( poll( fds, 1, 10 ) > 0 ) {
+				drain();
+			}
+		}
+		return ( WIFEXITED( status ) ? WEXITSTATUS( status ) : 1 );
+	}
+private:
+	void drain( void ) {
+		char buf[65536];
+		while ( true ) {
+			pollfd fds[] = { { _master, POLLIN, 0 } };
+			if ( ( poll( fds, 1, 0 ) <= 0 ) || ( read( _master, buf, sizeof ( buf ) ) <= 0 ) ) {
+				break;
+			}
+		}
+	}
+	static void fail( char const* message_ ) {
+		fprintf( stderr, "%s: %s\n", message_, strerror( errno ) );
+		_exit( 1 );
+	}
+};
+
+}
+
+#endif
+
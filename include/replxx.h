@@ -69,6 +69,20 @@ typedef enum {
 	ERROR         = -2
 } ReplxxColor;
 
+/*! \brief Get color from 256 color palette.
+ *
+ * Indexes 0-15 are basic colors.
+ * Terminals without 256 color support show the nearest basic color.
+ */
+ReplxxColor replxx_color_index( int index );
+
+/*! \brief Get 24-bit color from its red, green and blue components (0-255).
+ *
+ * Shown as is if COLORTERM reports truecolor support,
+ * otherwise the nearest palette color is used.
+ */
+ReplxxColor replxx_color_rgb( int red, int green, int blue );
+
 typedef struct Replxx Replxx;
 
 /*! \brief Create Replxx library resouce holder.
@@ -109,6 +123,53 @@ typedef void (replxx_highlighter_callback_t)(char const* input, ReplxxColor* col
  */
 void replxx_set_highlighter_callback( Replxx*, replxx_highlighter_callback_t* fn, void* userData );
 
+/*! \brief Incremental highlighter callback type definition.
+ *
+ * Alternative to highlighter callback for highlighters that can reuse results
+ * of previous invocation, e.g. re-lex only tokens touched by an edit.
+ * The callback is invoked only when the input changed since previous call.
+ *
+ * Before the call \e colors holds colors from previous invocation
+ * with the edit already applied, i.e. \e removed entries at \e pos are gone
+ * and \e inserted entries with REPLXX_COLOR_DEFAULT are in their place.
+ * All positions are counted in Unicode code points (not in bytes!).
+ *
+ * \param input - an input entered by the user so far.
+ * \param pos - position of the first changed character.
+ * \param removed - number of characters removed at \e pos since previous invocation.
+ * \param inserted - number of characters inserted at \e pos since previous invocation.
+ * \param colors - colors from previous invocation, to be updated in place.
+ * \param size - size of color information buffer.
+ * \param userData - pointer to opaque user data block.
+ */
+typedef void (replxx_incremental_highlighter_callback_t)(char const* input, int pos, int removed, int inserted, ReplxxColor* colors, int size, void* userData);
+
+/*! \brief Register incremental highlighter callback.
+ *
+ * When set it is used instead of highlighter callback.
+ *
+ * \param fn - user defined callback function.
+ * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+ */
+void replxx_set_incremental_highlighter_callback( Replxx*, replxx_incremental_highlighter_callback_t* fn, void* userData );
+
+/*! \brief Find bracket matching the one at given position of current input.
+ *
+ * Meant to be called from highlighter callbacks, e.g. to mark unmatched brackets.
+ * Brackets inside of string literals (see replxx_set_quote_characters()) are not matched.
+ *
+ * \param pos - position in current input, in Unicode code points.
+ * \return Position of matching bracket, -1 if there is no bracket at \e pos or it has no match.
+ */
+int replxx_matching_bracket( Replxx*, int pos );
+
+/*! \brief Tell if character of current input is a part of a string literal.
+ *
+ * \param pos - position in current input, in Unicode code points.
+ * \return 1 if it is, 0 otherwise.
+ */
+int replxx_is_quoted( Replxx*, int pos );
+
 typedef struct replxx_completions replxx_completions;
 
 /*! \brief Completions callback type definition.
@@ -142,6 +203,29 @@ void replxx_set_completion_callback( Replxx*, replxx_completion_callback_t* fn,
  */
 void replxx_add_completion( replxx_completions* completions, const char* str );
 
+/*! \brief Set words offered as completions and hints.
+ *
+ * Words starting with the text between the last word break and the cursor
+ * are offered after results of completion and hint callbacks,
+ * found with a binary search in a sorted copy of the words kept by the library.
+ * Hints are only offered for non-empty prefixes, at most as many
+ * as set with replxx_set_completion_count_cutoff().
+ * Asynchronous callbacks, when registered, are used instead.
+ *
+ * \param words - array of UTF-8 encoded words, replace previously set ones.
+ * \param count - number of words, 0 to remove them.
+ */
+void replxx_set_completion_words( Replxx*, char const** words, int count );
+
+/*! \brief Add words offered as completions and hints.
+ *
+ * Words are merged with ones set before, see replxx_set_completion_words().
+ *
+ * \param words - array of UTF-8 encoded words.
+ * \param count - number of words.
+ */
+void replxx_add_completion_words( Replxx*, char const** words, int count );
+
 typedef struct replxx_hints replxx_hints;
 
 /*! \brief Hints callback type definition.
@@ -176,6 +260,65 @@ void replxx_set_hint_callback( Replxx*, replxx_hint_callback_t* fn, void* userDa
  */
 void replxx_add_hint( replxx_hints* hints, const char* str );
 
+/*! \brief Asynchronous completions and hints callback type definition.
+ *
+ * The callback must return quickly, results are delivered later,
+ * possibly from another thread, with replxx_post_completions() or replxx_post_hints()
+ * and given \e requestId.
+ *
+ * \param input - the whole input entered by the user so far.
+ * \param breakPos - index of last break character before cursor.
+ * \param requestId - identifier of this request.
+ * \param userData - pointer to opaque user data block.
+ */
+typedef void (replxx_async_callback_t)(char const* input, int breakPos, int requestId, void* userData);
+
+/*! \brief Register asynchronous completion callback.
+ *
+ * When set it is used instead of completion callback.
+ *
+ * \param fn - user defined callback function.
+ * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+ */
+void replxx_set_async_completion_callback( Replxx*, replxx_async_callback_t* fn, void* userData );
+
+/*! \brief Register asynchronous hints callback.
+ *
+ * When set it is used instead of hints callback.
+ *
+ * \param fn - user defined callback function.
+ * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+ */
+void replxx_set_async_hint_callback( Replxx*, replxx_async_callback_t* fn, void* userData );
+
+/*! \brief Deliver results of asynchronous completion request.
+ *
+ * Can be called from any thread, results of stale requests are dropped.
+ *
+ * \param requestId - identifier passed to asynchronous completion callback.
+ * \param completions - array of UTF-8 encoded completion strings.
+ * \param count - number of completions.
+ */
+void replxx_post_completions( Replxx*, int requestId, char const** completions, int count );
+
+/*! \brief Deliver results of asynchronous hints request.
+ *
+ * Can be called from any thread, results of stale requests are dropped.
+ *
+ * \param requestId - identifier passed to asynchronous hints callback.
+ * \param hints - array of UTF-8 encoded hint strings.
+ * \param count - number of hints.
+ * \param color - a color used for displaying hints.
+ */
+void replxx_post_hints( Replxx*, int requestId, char const** hints, int count, ReplxxColor color );
+
+/*! \brief Tell if asynchronous request is still awaited.
+ *
+ * \param requestId - identifier passed to asynchronous callback.
+ * \return Non-zero iff results for given request would still be used.
+ */
+int replxx_is_request_current( Replxx*, int requestId );
+
 /*! \brief Read line of user input.
  *
  * \param prompt - prompt to be displayed before getting user input.
@@ -216,7 +359,20 @@ void replxx_set_word_break_characters( Replxx*, char const* wordBreakers );
  */
 void replxx_set_special_prefixes( Replxx*, char const* specialPrefixes );
 
+/*! \brief Set quote characters.
+ *
+ * Text from a quote character to the next occurrence of the same
+ * character is a string literal, brackets inside of it are not matched.
+ * Backslash inside of a string literal escapes the next character.
+ *
+ * \param quoteChars - 7-bit ASCII set of quote characters, "\"'" by default.
+ */
+void replxx_set_quote_characters( Replxx*, char const* quoteChars );
+
 /*! \brief Set maximum allowed length of user input.
+ *
+ * Length is counted in Unicode code points, by default (or with \e len 0)
+ * it is not limited and the input buffer grows as needed.
  */
 void replxx_set_max_line_size( Replxx*, int len );
 
@@ -224,6 +380,15 @@ void replxx_set_max_line_size( Replxx*, int len );
  */
 void replxx_set_max_hint_rows( Replxx*, int count );
 
+/*! \brief Set a delay before hints are shown.
+ *
+ * Hints callback is invoked only after user stops typing for given time,
+ * 0 (the default) shows hints right away.
+ *
+ * \param milliseconds - a delay in milliseconds.
+ */
+void replxx_set_hint_delay( Replxx*, int milliseconds );
+
 /*! \brief Set tab completion behavior.
  *
  * \param val - use double tab to invoke completions (if != 0).
@@ -254,11 +419,32 @@ void replxx_set_max_history_size( Replxx*, int len );
 char const* replxx_history_line( Replxx*, int index );
 int replxx_history_save( Replxx*, const char* filename );
 int replxx_history_load( Replxx*, const char* filename );
+
+/*! \brief Append new history entries to history file.
+ *
+ * Only entries added since last save, load or sync with the same file
+ * are written, the file is rewritten from scratch when it grows
+ * past twice the maximum history size.
+ *
+ * \param filename - path to history file.
+ * \return 0 on success, -1 on error.
+ */
+int replxx_history_sync( Replxx*, const char* filename );
 void replxx_clear_screen( Replxx* );
 void replxx_debug_dump_print_codes(void);
 /* the following is extension to the original linenoise API */
 int replxx_install_window_change_handler( Replxx* );
 
+/*! \brief Get terminal output statistics.
+ *
+ * Number of bytes written while redrawing user input divided by number
+ * of processed keystrokes gives average terminal traffic per keystroke.
+ *
+ * \param keystrokes - number of keystrokes processed so far.
+ * \param bytes - number of bytes written to the terminal while processing them.
+ */
+void replxx_output_stats( Replxx*, long long* keystrokes, long long* bytes );
+
 #ifdef __cplusplus
 }
 #endif
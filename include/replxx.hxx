@@ -65,6 +65,99 @@ public:
 	typedef std::vector<Color> colors_t;
 	typedef std::vector<std::string> completions_t;
 	typedef std::vector<std::string> hints_t;
+
+	/*! \brief Read-only view of user input.
+	 *
+	 * Refers to a buffer maintained by the library, it is valid only
+	 * until the callback it was passed to returns.
+	 * Input is available both as null terminated UTF-8 text
+	 * and as Unicode code points, in which all callback positions are counted.
+	 */
+	class InputView {
+		char const* _data;
+		int _size;
+		char32_t const* _codePoints;
+		int _length;
+	public:
+		InputView( char const* data_, int size_, char32_t const* codePoints_, int length_ )
+			: _data( data_ )
+			, _size( size_ )
+			, _codePoints( codePoints_ )
+			, _length( length_ ) {
+		}
+		/*! \brief UTF-8 encoded input, null terminated. */
+		char const* data( void ) const {
+			return ( _data );
+		}
+		/*! \brief Size of UTF-8 encoded input in bytes. */
+		int size( void ) const {
+			return ( _size );
+		}
+		/*! \brief Input as Unicode code points, not null terminated. */
+		char32_t const* code_points( void ) const {
+			return ( _codePoints );
+		}
+		/*! \brief Length of input in Unicode code points. */
+		int length( void ) const {
+			return ( _length );
+		}
+		/*! \brief Copy of UTF-8 encoded input. */
+		std::string str( void ) const {
+			return ( std::string( _data, _size ) );
+		}
+	};
+
+	/*! \brief Reusable collector of completions or hints.
+	 *
+	 * Strings are stored back to back in a single buffer which the library
+	 * clears and reuses between callback invocations, so once it has grown
+	 * adding results does not allocate.
+	 */
+	class Collector {
+		std::string _buffer;      // added strings, each followed by a terminator
+		std::vector<int> _starts; // offset of each string in _buffer
+	public:
+		Collector( void )
+			: _buffer()
+			, _starts() {
+		}
+		/*! \brief Add UTF-8 encoded string of given size in bytes. */
+		void add( char const* str_, int size_ ) {
+			_starts.push_back( static_cast<int>( _buffer.size() ) );
+			_buffer.append( str_, static_cast<size_t>( size_ ) ).push_back( 0 );
+		}
+		/*! \brief Add null terminated UTF-8 encoded string. */
+		void add( char const* str_ ) {
+			add( str_, static_cast<int>( std::char_traits<char>::length( str_ ) ) );
+		}
+		/*! \brief Add UTF-8 encoded string. */
+		void add( std::string const& str_ ) {
+			add( str_.data(), static_cast<int>( str_.size() ) );
+		}
+		/*! \brief Number of collected strings. */
+		int count( void ) const {
+			return ( static_cast<int>( _starts.size() ) );
+		}
+		/*! \brief Get null terminated collected string. */
+		char const* get( int index_ ) const {
+			return ( _buffer.data() + _starts[index_] );
+		}
+		/*! \brief Size of collected string in bytes. */
+		int size( int index_ ) const {
+			int end( index_ + 1 < count() ? _starts[index_ + 1] : static_cast<int>( _buffer.size() ) );
+			return ( end - _starts[index_] - 1 );
+		}
+		/*! \brief Remove all strings, keep storage. */
+		void clear( void ) {
+			_buffer.clear();
+			_starts.clear();
+		}
+		void swap( Collector& other_ ) {
+			_buffer.swap( other_._buffer );
+			_starts.swap( other_._starts );
+		}
+	};
+
 	/*! \brief Completions callback type definition.
 	 *
 	 * \e breakPos is counted in Unicode code points (not in bytes!).
@@ -82,6 +175,19 @@ public:
 	 */
 	typedef std::function<completions_t ( std::string const& input, int breakPos, void* userData)> completion_callback_t;
 
+	/*! \brief Completions callback type taking a view of user input.
+	 *
+	 * Same as completion_callback_t but input is not copied.
+	 */
+	typedef std::function<completions_t ( InputView const& input, int breakPos, void* userData)> completion_view_callback_t;
+
+	/*! \brief Completions callback type adding results to a collector.
+	 *
+	 * Same as completion_view_callback_t but completions are added to \e completions,
+	 * which is empty on entry.
+	 */
+	typedef std::function<void ( InputView const& input, int breakPos, Collector& completions, void* userData)> completion_collector_callback_t;
+
 	/*! \brief Highlighter callback type definition.
 	 *
 	 * If user want to have colorful input she must simply install highlighter callback.
@@ -95,6 +201,38 @@ public:
 	 */
 	typedef std::function<void ( std::string const& input, colors_t& colors, void* userData )> highlighter_callback_t;
 
+	/*! \brief Highlighter callback type taking a view of user input.
+	 *
+	 * Same as highlighter_callback_t but input is not copied.
+	 */
+	typedef std::function<void ( InputView const& input, colors_t& colors, void* userData )> highlighter_view_callback_t;
+
+	/*! \brief Incremental highlighter callback type definition.
+	 *
+	 * Alternative to highlighter callback for highlighters that can reuse results
+	 * of previous invocation, e.g. re-lex only tokens touched by an edit.
+	 * The callback is invoked only when the input changed since previous call.
+	 *
+	 * Before the call \e colors holds colors from previous invocation
+	 * with the edit already applied, i.e. \e removed entries at \e pos are gone
+	 * and \e inserted entries with Color::DEFAULT are in their place.
+	 * All positions are counted in Unicode code points (not in bytes!).
+	 *
+	 * \param input - an input entered by the user so far.
+	 * \param pos - position of the first changed character.
+	 * \param removed - number of characters removed at \e pos since previous invocation.
+	 * \param inserted - number of characters inserted at \e pos since previous invocation.
+	 * \param colors - colors from previous invocation, to be updated in place.
+	 * \param userData - pointer to opaque user data block.
+	 */
+	typedef std::function<void ( std::string const& input, int pos, int removed, int inserted, colors_t& colors, void* userData )> incremental_highlighter_callback_t;
+
+	/*! \brief Incremental highlighter callback type taking a view of user input.
+	 *
+	 * Same as incremental_highlighter_callback_t but input is not copied.
+	 */
+	typedef std::function<void ( InputView const& input, int pos, int removed, int inserted, colors_t& colors, void* userData )> incremental_highlighter_view_callback_t;
+
 	/*! \brief Hints callback type definition.
 	 *
 	 * \e breakPos is counted in Unicode code points (not in bytes!).
@@ -113,6 +251,44 @@ public:
 	 */
 	typedef std::function<hints_t ( std::string const& input, int breakPos, Color& color, void* userData )> hint_callback_t;
 
+	/*! \brief Hints callback type taking a view of user input.
+	 *
+	 * Same as hint_callback_t but input is not copied.
+	 */
+	typedef std::function<hints_t ( InputView const& input, int breakPos, Color& color, void* userData )> hint_view_callback_t;
+
+	/*! \brief Hints callback type adding results to a collector.
+	 *
+	 * Same as hint_view_callback_t but hints are added to \e hints,
+	 * which is empty on entry.
+	 */
+	typedef std::function<void ( InputView const& input, int breakPos, Collector& hints, Color& color, void* userData )> hint_collector_callback_t;
+
+	/*! \brief Asynchronous completions callback type definition.
+	 *
+	 * The callback must return quickly, completions are delivered later,
+	 * possibly from another thread, with post_completions() and given \e requestId.
+	 *
+	 * \param input - the whole input entered by the user so far.
+	 * \param breakPos - index of last break character before cursor.
+	 * \param requestId - identifier of this request.
+	 * \param userData - pointer to opaque user data block.
+	 */
+	typedef std::function<void ( std::string const& input, int breakPos, int requestId, void* userData )> async_completion_callback_t;
+
+	/*! \brief Asynchronous hints callback type definition.
+	 *
+	 * The callback must return quickly, hints are delivered later,
+	 * possibly from another thread, with post_hints() and given \e requestId.
+	 * Until then input is displayed without hints.
+	 *
+	 * \param input - the whole input entered by the user so far.
+	 * \param breakPos - index of last break character before cursor.
+	 * \param requestId - identifier of this request.
+	 * \param userData - pointer to opaque user data block.
+	 */
+	typedef std::function<void ( std::string const& input, int breakPos, int requestId, void* userData )> async_hint_callback_t;
+
 	class ReplxxImpl;
 private:
 	typedef std::unique_ptr<ReplxxImpl, void (*)( ReplxxImpl* )> impl_t;
@@ -130,6 +306,45 @@ public:
 	 */
 	void set_completion_callback( completion_callback_t const& fn, void* userData );
 
+	/*! \brief Register completion callback taking a view of user input.
+	 *
+	 * Replaces callback registered with set_completion_callback().
+	 *
+	 * \param fn - user defined callback function.
+	 * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+	 */
+	void set_completion_view_callback( completion_view_callback_t const& fn, void* userData );
+
+	/*! \brief Register completion callback adding results to a collector.
+	 *
+	 * Replaces callback registered with set_completion_callback().
+	 *
+	 * \param fn - user defined callback function.
+	 * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+	 */
+	void set_completion_collector_callback( completion_collector_callback_t const& fn, void* userData );
+
+	/*! \brief Set words offered as completions and hints.
+	 *
+	 * Words starting with the text between the last word break and the cursor
+	 * are offered after results of completion and hint callbacks,
+	 * found with a binary search in a sorted copy of the words kept by the library.
+	 * Hints are only offered for non-empty prefixes, at most as many
+	 * as set with set_completion_count_cutoff().
+	 * Asynchronous callbacks, when registered, are used instead.
+	 *
+	 * \param words - UTF-8 encoded words, replace previously set ones, empty to remove them.
+	 */
+	void set_completion_words( completions_t const& words );
+
+	/*! \brief Add words offered as completions and hints.
+	 *
+	 * Words are merged with ones set before, see set_completion_words().
+	 *
+	 * \param words - UTF-8 encoded words.
+	 */
+	void add_completion_words( completions_t const& words );
+
 	/*! \brief Register highlighter callback.
 	 *
 	 * \param fn - user defined callback function.
@@ -137,6 +352,49 @@ public:
 	 */
 	void set_highlighter_callback( highlighter_callback_t const& fn, void* userData );
 
+	/*! \brief Register highlighter callback taking a view of user input.
+	 *
+	 * Replaces callback registered with set_highlighter_callback().
+	 *
+	 * \param fn - user defined callback function.
+	 * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+	 */
+	void set_highlighter_view_callback( highlighter_view_callback_t const& fn, void* userData );
+
+	/*! \brief Register incremental highlighter callback.
+	 *
+	 * When set it is used instead of highlighter callback.
+	 *
+	 * \param fn - user defined callback function.
+	 * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+	 */
+	void set_incremental_highlighter_callback( incremental_highlighter_callback_t const& fn, void* userData );
+
+	/*! \brief Register incremental highlighter callback taking a view of user input.
+	 *
+	 * Replaces callback registered with set_incremental_highlighter_callback().
+	 *
+	 * \param fn - user defined callback function.
+	 * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+	 */
+	void set_incremental_highlighter_view_callback( incremental_highlighter_view_callback_t const& fn, void* userData );
+
+	/*! \brief Find bracket matching the one at given position of current input.
+	 *
+	 * Meant to be called from highlighter callbacks, e.g. to mark unmatched brackets.
+	 * Brackets inside of string literals (see set_quote_characters()) are not matched.
+	 *
+	 * \param pos - position in current input, in Unicode code points.
+	 * \return Position of matching bracket, -1 if there is no bracket at \e pos or it has no match.
+	 */
+	int matching_bracket( int pos );
+
+	/*! \brief Tell if character of current input is a part of a string literal.
+	 *
+	 * \param pos - position in current input, in Unicode code points.
+	 */
+	bool is_quoted( int pos );
+
 	/*! \brief Register hints callback.
 	 *
 	 * \param fn - user defined callback function.
@@ -144,6 +402,71 @@ public:
 	 */
 	void set_hint_callback( hint_callback_t const& fn, void* userData );
 
+	/*! \brief Register hints callback taking a view of user input.
+	 *
+	 * Replaces callback registered with set_hint_callback().
+	 *
+	 * \param fn - user defined callback function.
+	 * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+	 */
+	void set_hint_view_callback( hint_view_callback_t const& fn, void* userData );
+
+	/*! \brief Register hints callback adding results to a collector.
+	 *
+	 * Replaces callback registered with set_hint_callback().
+	 *
+	 * \param fn - user defined callback function.
+	 * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+	 */
+	void set_hint_collector_callback( hint_collector_callback_t const& fn, void* userData );
+
+	/*! \brief Register asynchronous completion callback.
+	 *
+	 * When set it is used instead of completion callback.
+	 *
+	 * \param fn - user defined callback function.
+	 * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+	 */
+	void set_async_completion_callback( async_completion_callback_t const& fn, void* userData );
+
+	/*! \brief Register asynchronous hints callback.
+	 *
+	 * When set it is used instead of hints callback.
+	 *
+	 * \param fn - user defined callback function.
+	 * \param userData - pointer to opaque user data block to be passed into each invocation of the callback.
+	 */
+	void set_async_hint_callback( async_hint_callback_t const& fn, void* userData );
+
+	/*! \brief Deliver results of asynchronous completion request.
+	 *
+	 * Can be called from any thread, results of stale requests are dropped.
+	 *
+	 * \param requestId - identifier passed to asynchronous completion callback.
+	 * \param completions - a list of user completions.
+	 */
+	void post_completions( int requestId, completions_t const& completions );
+
+	/*! \brief Deliver results of asynchronous hints request.
+	 *
+	 * Can be called from any thread, results of stale requests are dropped.
+	 *
+	 * \param requestId - identifier passed to asynchronous hints callback.
+	 * \param hints - a list of possible hints.
+	 * \param color - a color used for displaying hints.
+	 */
+	void post_hints( int requestId, hints_t const& hints, Color color );
+
+	/*! \brief Tell if asynchronous request is still awaited.
+	 *
+	 * A request is cancelled when the user changes the input before its results arrive,
+	 * providers can use this to abandon work early. Can be called from any thread.
+	 *
+	 * \param requestId - identifier passed to asynchronous callback.
+	 * \return True iff results for given request would still be used.
+	 */
+	bool is_request_current( int requestId ) const;
+
 	/*! \brief Read line of user input.
 	 *
 	 * \param prompt - prompt to be displayed before getting user input.
@@ -164,6 +487,17 @@ public:
 	void history_add( std::string const& line );
 	int history_save( std::string const& filename );
 	int history_load( std::string const& filename );
+
+	/*! \brief Append new history entries to history file.
+	 *
+	 * Only entries added since last save, load or sync with the same file
+	 * are written, the file is rewritten from scratch when it grows
+	 * past twice the maximum history size.
+	 *
+	 * \param filename - path to history file.
+	 * \return 0 on success, -1 on error.
+	 */
+	int history_sync( std::string const& filename );
 	int history_size( void ) const;
 	std::string const& history_line( int index );
 
@@ -187,7 +521,20 @@ public:
 	 */
 	void set_special_prefixes( char const* specialPrefixes );
 
+	/*! \brief Set quote characters.
+	 *
+	 * Text from a quote character to the next occurrence of the same
+	 * character is a string literal, brackets inside of it are not matched.
+	 * Backslash inside of a string literal escapes the next character.
+	 *
+	 * \param quoteChars - 7-bit ASCII set of quote characters, "\"'" by default.
+	 */
+	void set_quote_characters( char const* quoteChars );
+
 	/*! \brief Set maximum allowed length of user input.
+	 *
+	 * Length is counted in Unicode code points, by default (or with \e len 0)
+	 * it is not limited and the input buffer grows as needed.
 	 */
 	void set_max_line_size( int len );
 
@@ -195,6 +542,15 @@ public:
 	 */
 	void set_max_hint_rows( int count );
 
+	/*! \brief Set a delay before hints are shown.
+	 *
+	 * Hints callback is invoked only after user stops typing for given time,
+	 * 0 (the default) shows hints right away.
+	 *
+	 * \param milliseconds - a delay in milliseconds.
+	 */
+	void set_hint_delay( int milliseconds );
+
 	/*! \brief Set tab completion behavior.
 	 *
 	 * \param val - use double tab to invoke completions.
@@ -225,6 +581,30 @@ public:
 	void clear_screen( void );
 	int install_window_change_handler( void );
 
+	/*! \brief Get color from 256 color palette.
+	 *
+	 * Indexes 0-15 are basic colors.
+	 * Terminals without 256 color support show the nearest basic color.
+	 */
+	static Color color_index( int index );
+
+	/*! \brief Get 24-bit color from its red, green and blue components (0-255).
+	 *
+	 * Shown as is if COLORTERM reports truecolor support,
+	 * otherwise the nearest palette color is used.
+	 */
+	static Color color_rgb( int red, int green, int blue );
+
+	/*! \brief Get terminal output statistics.
+	 *
+	 * Number of bytes written while redrawing user input divided by number
+	 * of processed keystrokes gives average terminal traffic per keystroke.
+	 *
+	 * \param keystrokes - number of keystrokes processed so far.
+	 * \param bytes - number of bytes written to the terminal while processing them.
+	 */
+	void output_stats( long long& keystrokes, long long& bytes ) const;
+
 private:
 	Replxx( Replxx const& ) = delete;
 	Replxx& operator = ( Replxx const& ) = delete;
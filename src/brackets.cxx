@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "brackets.hxx"
+
+using namespace std;
+
+namespace replxx {
+
+namespace {
+
+// quote characters past this many are ignored, states must fit in a byte
+int const MAX_QUOTES = 100;
+
+int bracket_kind( char32_t c ) {
+	switch ( c ) {
+		case '(': return (  1 );
+		case ')': return ( -1 );
+		case '[': return (  2 );
+		case ']': return ( -2 );
+		case '{': return (  3 );
+		case '}': return ( -3 );
+	}
+	return ( 0 );
+}
+
+}
+
+Brackets::Brackets( void )
+	: _quotes()
+	, _kinds()
+	, _states()
+	, _tree( 2, Node() )
+	, _leaves( 1 )
+	, _valid( 0 ) {
+}
+
+void Brackets::set_quotes( char const* quotes_ ) {
+	string quotes( quotes_ ? quotes_ : "" );
+	if ( static_cast<int>( quotes.length() ) > MAX_QUOTES ) {
+		quotes.resize( MAX_QUOTES );
+	}
+	if ( quotes != _quotes ) {
+		_quotes.swap( quotes );
+		invalidate( 0 );
+	}
+}
+
+/*
+ * Classify characters from the first changed one to the end
+ * and rebuild tree nodes covering them.
+ *
+ * String literal state is 0 outside of literals, index of the quote
+ * plus 1 inside of a literal and that plus number of quotes
+ * right after a backslash inside of a literal.
+ */
+void Brackets::update( char32_t const* text_, int len_ ) {
+	int oldLen( static_cast<int>( _kinds.size() ) );
+	if ( ( _valid >= len_ ) && ( oldLen == len_ ) ) {
+		return;
+	}
+	int from( min( _valid, len_ ) );
+	_kinds.resize( len_ );
+	_states.resize( len_ );
+	int quoteCount( static_cast<int>( _quotes.length() ) );
+	int state( from > 0 ? _states[from - 1] : 0 );
+	for ( int i( from ); i < len_; ++ i ) {
+		char32_t c( text_[i] );
+		int kind( 0 );
+		if ( state == 0 ) {
+			string::size_type quote( c < 128 ? _quotes.find( static_cast<char>( c ) ) : string::npos );
+			if ( quote != string::npos ) {
+				state = static_cast<int>( quote ) + 1;
+			} else {
+				kind = bracket_kind( c );
+			}
+		} else if ( state > quoteCount ) {
+			state -= quoteCount;
+		} else if ( c == '\\' ) {
+			state += quoteCount;
+		} else if ( c == static_cast<char32_t>( _quotes[state - 1] ) ) {
+			state = 0;
+		}
+		_kinds[i] = static_cast<signed char>( kind );
+		_states[i] = static_cast<unsigned char>( state );
+	}
+	_valid = len_;
+	int blocks( ( len_ + BLOCK - 1 ) / BLOCK );
+	int oldBlocks( ( oldLen + BLOCK - 1 ) / BLOCK );
+	int first( from / BLOCK );
+	if ( blocks > _leaves ) {
+		while ( _leaves < blocks ) {
+			_leaves *= 2;
+		}
+		_tree.assign( 2 * _leaves, Node() );
+		first = 0;
+	}
+	int last( max( blocks, oldBlocks ) );
+	if ( first >= last ) {
+		return;
+	}
+	for ( int b( first ); b < last; ++ b ) {
+		build_leaf( b );
+	}
+	for ( int lo( ( _leaves + first ) / 2 ), hi( ( _leaves + last - 1 ) / 2 ); lo > 0; lo /= 2, hi /= 2 ) {
+		for ( int i( lo ); i <= hi; ++ i ) {
+			Node const& left( _tree[2 * i] );
+			Node const& right( _tree[2 * i + 1] );
+			Node& node( _tree[i] );
+			for ( int k( 0 ); k < KINDS; ++ k ) {
+				node.sum[k] = left.sum[k] + right.sum[k];
+				node.minPrefix[k] = min( left.minPrefix[k], left.sum[k] + right.minPrefix[k] );
+			}
+		}
+	}
+}
+
+void Brackets::build_leaf( int block_ ) {
+	Node& node( _tree[_leaves + block_] );
+	node = Node();
+	int end( min( ( block_ + 1 ) * BLOCK, static_cast<int>( _kinds.size() ) ) );
+	for ( int i( block_ * BLOCK ); i < end; ++ i ) {
+		int kind( _kinds[i] );
+		if ( kind != 0 ) {
+			int k( abs( kind ) - 1 );
+			node.sum[k] += ( kind > 0 ? 1 : -1 );
+			node.minPrefix[k] = min( node.minPrefix[k], node.sum[k] );
+		}
+	}
+}
+
+int Brackets::value( int pos_, int kind_ ) const {
+	int kind( _kinds[pos_] );
+	return ( kind == kind_ + 1 ? 1 : ( kind == -kind_ - 1 ? -1 : 0 ) );
+}
+
+/*
+ * Depth change of given kind of brackets over characters before pos_.
+ */
+int Brackets::prefix_sum( int pos_, int kind_ ) const {
+	int block( pos_ / BLOCK );
+	int sum( 0 );
+	for ( int l( _leaves ), r( _leaves + block ); l < r; l /= 2, r /= 2 ) {
+		if ( l & 1 ) {
+			sum += _tree[l ++].sum[kind_];
+		}
+		if ( r & 1 ) {
+			sum += _tree[-- r].sum[kind_];
+		}
+	}
+	for ( int i( block * BLOCK ); i < pos_; ++ i ) {
+		sum += value( i, kind_ );
+	}
+	return ( sum );
+}
+
+/*
+ * First block, starting with from_, where running depth
+ * of given kind of brackets drops below zero.
+ */
+int Brackets::find_forward( int node_, int lo_, int hi_, int from_, int kind_, int& run_ ) const {
+	if ( hi_ < from_ ) {
+		return ( -1 );
+	}
+	Node const& node( _tree[node_] );
+	if ( ( lo_ >= from_ ) && ( ( run_ + node.minPrefix[kind_] ) >= 0 ) ) {
+		run_ += node.sum[kind_];
+		return ( -1 );
+	}
+	if ( lo_ == hi_ ) {
+		return ( lo_ );
+	}
+	int mid( ( lo_ + hi_ ) / 2 );
+	int found( find_forward( 2 * node_, lo_, mid, from_, kind_, run_ ) );
+	return ( found >= 0 ? found : find_forward( 2 * node_ + 1, mid + 1, hi_, from_, kind_, run_ ) );
+}
+
+/*
+ * Last block, ending with to_, where depth of given kind of brackets
+ * counted backwards rises above zero.
+ */
+int Brackets::find_backward( int node_, int lo_, int hi_, int to_, int kind_, int& run_ ) const {
+	if ( lo_ > to_ ) {
+		return ( -1 );
+	}
+	Node const& node( _tree[node_] );
+	if ( ( hi_ <= to_ ) && ( ( run_ + node.sum[kind_] - node.minPrefix[kind_] ) <= 0 ) ) {
+		run_ += node.sum[kind_];
+		return ( -1 );
+	}
+	if ( lo_ == hi_ ) {
+		return ( lo_ );
+	}
+	int mid( ( lo_ + hi_ ) / 2 );
+	int found( find_backward( 2 * node_ + 1, mid + 1, hi_, to_, kind_, run_ ) );
+	return ( found >= 0 ? found : find_backward( 2 * node_, lo_, mid, to_, kind_, run_ ) );
+}
+
+/*
+ * Position of the bracket matching the one at pos_, -1 if there is
+ * no bracket at pos_ or it has no match.  If other kinds of brackets
+ * between the two are not balanced *unbalanced_ is set.
+ */
+int Brackets::match( char32_t const* text_, int len_, int pos_, bool* unbalanced_ ) {
+	update( text_, len_ );
+	if ( ( pos_ < 0 ) || ( pos_ >= len_ ) || ( _kinds[pos_] == 0 ) ) {
+		return ( -1 );
+	}
+	int kind( abs( _kinds[pos_] ) - 1 );
+	int block( pos_ / BLOCK );
+	int run( 0 );
+	int found( -1 );
+	if ( _kinds[pos_] > 0 ) {
+		int end( min( ( block + 1 ) * BLOCK, len_ ) );
+		for ( int i( pos_ + 1 ); i < end; ++ i ) {
+			run += value( i, kind );
+			if ( run < 0 ) {
+				found = i;
+				break;
+			}
+		}
+		int b( found < 0 ? find_forward( 1, 0, _leaves - 1, block + 1, kind, run ) : -1 );
+		for ( int i( b * BLOCK ); ( b >= 0 ) && ( found < 0 ); ++ i ) {
+			run += value( i, kind );
+			if ( run < 0 ) {
+				found = i;
+			}
+		}
+	} else {
+		for ( int i( pos_ - 1 ); i >= block * BLOCK; -- i ) {
+			run += value( i, kind );
+			if ( run > 0 ) {
+				found = i;
+				break;
+			}
+		}
+		int b( found < 0 ? find_backward( 1, 0, _leaves - 1, block - 1, kind, run ) : -1 );
+		for ( int i( ( b + 1 ) * BLOCK - 1 ); ( b >= 0 ) && ( found < 0 ); -- i ) {
+			run += value( i, kind );
+			if ( run > 0 ) {
+				found = i;
+			}
+		}
+	}
+	if ( ( found >= 0 ) && unbalanced_ ) {
+		int lo( min( pos_, found ) + 1 );
+		int hi( max( pos_, found ) );
+		*unbalanced_ = false;
+		for ( int k( 0 ); k < KINDS; ++ k ) {
+			if ( ( k != kind ) && ( prefix_sum( hi, k ) != prefix_sum( lo, k ) ) ) {
+				*unbalanced_ = true;
+			}
+		}
+	}
+	return ( found );
+}
+
+/*
+ * Tell if character at pos_ is a part of a string literal,
+ * including its quotes.
+ */
+bool Brackets::quoted( char32_t const* text_, int len_, int pos_ ) {
+	update( text_, len_ );
+	if ( ( pos_ < 0 ) || ( pos_ >= len_ ) ) {
+		return ( false );
+	}
+	return ( ( _states[pos_] != 0 ) || ( ( pos_ > 0 ) && ( _states[pos_ - 1] != 0 ) ) );
+}
+
+}
+
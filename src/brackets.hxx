@@ -0,0 +1,64 @@
+#ifndef REPLXX_BRACKETS_HXX_INCLUDED
+#define REPLXX_BRACKETS_HXX_INCLUDED 1
+
+#include <vector>
+#include <string>
+
+namespace replxx {
+
+/*! \brief Bracket structure of input buffer.
+ *
+ * Each character is classified once, as an opening or closing bracket
+ * of one of three kinds, ( [ and {, or as anything else.  Brackets
+ * inside string literals, delimited by any of the quote characters
+ * and with backslash escaping the next character, are not brackets.
+ *
+ * Characters are grouped in blocks and a segment tree keeps, for each
+ * kind of bracket, the bracket depth change and the minimum depth
+ * reached over every range of blocks, so the matching bracket of any
+ * position is found in O(log n).
+ *
+ * Edits only record the first changed position, classification
+ * and the tree are brought up to date from there on next query.
+ */
+class Brackets {
+public:
+	static int const KINDS = 3;
+	static int const BLOCK = 64;
+	typedef std::vector<signed char> kinds_t;
+	typedef std::vector<unsigned char> states_t;
+	struct Node {
+		int sum[KINDS];      // depth change over the range
+		int minPrefix[KINDS]; // lowest depth reached, relative to range start, 0 at most
+	};
+	typedef std::vector<Node> tree_t;
+private:
+	std::string _quotes;
+	kinds_t  _kinds;   // 1 + kind for opening, -1 - kind for closing bracket, 0 otherwise
+	states_t _states;  // string literal state after each character
+	tree_t   _tree;    // 1-based, leaves are blocks of characters
+	int      _leaves;  // number of leaves, power of 2
+	int      _valid;   // characters before this position are classified
+public:
+	Brackets( void );
+	void set_quotes( char const* );
+	void invalidate( int pos_ ) {
+		if ( pos_ < _valid ) {
+			_valid = pos_;
+		}
+	}
+	int match( char32_t const*, int, int, bool* = nullptr );
+	bool quoted( char32_t const*, int, int );
+private:
+	void update( char32_t const*, int );
+	void build_leaf( int );
+	int value( int pos_, int kind_ ) const;
+	int prefix_sum( int, int ) const;
+	int find_forward( int, int, int, int, int, int& ) const;
+	int find_backward( int, int, int, int, int, int& ) const;
+};
+
+}
+
+#endif
+
@@ -0,0 +1,123 @@
+#ifndef REPLXX_CHARWIDTHS_HXX_INCLUDED
+#define REPLXX_CHARWIDTHS_HXX_INCLUDED 1
+
+#include <vector>
+
+namespace replxx {
+
+int mk_wcwidth( char32_t );
+
+/*! \brief Column widths of characters in input buffer.
+ *
+ * Width of each character is computed once, when it is inserted,
+ * and running totals are kept in Fenwick trees so the column
+ * of any buffer position is found in O(log n).  Insertion or removal
+ * rebuilds the trees from the edit point on in time linear in length
+ * of the rest of the buffer, same as moving its characters.
+ *
+ * Characters without defined width (control characters) are counted
+ * separately, if any of them precedes given position the column
+ * is the character count, same as in calculateColumnPosition().
+ */
+class CharWidths {
+public:
+	typedef std::vector<signed char> widths_t;
+	typedef std::vector<int> tree_t;
+private:
+	widths_t _widths;   // mk_wcwidth() of each character
+	tree_t   _columns;  // Fenwick tree of widths, 1-based
+	tree_t   _controls; // Fenwick tree of characters without width, 1-based
+public:
+	CharWidths( void )
+		: _widths()
+		, _columns( 1, 0 )
+		, _controls( 1, 0 ) {
+	}
+	int size( void ) const {
+		return ( static_cast<int>( _widths.size() ) );
+	}
+	void reset( char32_t const* text_, int len_ ) {
+		_widths.resize( len_ );
+		for ( int i( 0 ); i < len_; ++ i ) {
+			_widths[i] = mk_wcwidth( text_[i] );
+		}
+		rebuild( 0 );
+	}
+	void insert( int pos_, char32_t const* text_, int count_ ) {
+		_widths.insert( _widths.begin() + pos_, count_, 0 );
+		for ( int i( 0 ); i < count_; ++ i ) {
+			_widths[pos_ + i] = mk_wcwidth( text_[i] );
+		}
+		rebuild( pos_ );
+	}
+	void erase( int pos_, int count_ ) {
+		_widths.erase( _widths.begin() + pos_, _widths.begin() + pos_ + count_ );
+		rebuild( pos_ );
+	}
+	void replace( int pos_, char32_t const* text_, int count_ ) {
+		for ( int i( 0 ); i < count_; ++ i ) {
+			int oldWidth( _widths[pos_ + i] );
+			int newWidth( mk_wcwidth( text_[i] ) );
+			if ( newWidth != oldWidth ) {
+				_widths[pos_ + i] = newWidth;
+				add( _columns, pos_ + i, column_width( newWidth ) - column_width( oldWidth ) );
+				add( _controls, pos_ + i, is_control( newWidth ) - is_control( oldWidth ) );
+			}
+		}
+	}
+	/*! \brief Get screen column of given position in the buffer.
+	 */
+	int column( int pos_ ) const {
+		return ( prefix_sum( _controls, pos_ ) > 0 ? pos_ : prefix_sum( _columns, pos_ ) );
+	}
+private:
+	static int column_width( int width_ ) {
+		return ( width_ > 0 ? width_ : 0 );
+	}
+	static int is_control( int width_ ) {
+		return ( width_ < 0 ? 1 : 0 );
+	}
+	static int prefix_sum( tree_t const& tree_, int pos_ ) {
+		int sum( 0 );
+		for ( int i( pos_ ); i > 0; i -= ( i & -i ) ) {
+			sum += tree_[i];
+		}
+		return ( sum );
+	}
+	void add( tree_t& tree_, int pos_, int delta_ ) {
+		for ( int i( pos_ + 1 ), n( size() ); i <= n; i += ( i & -i ) ) {
+			tree_[i] += delta_;
+		}
+	}
+	// nodes of a Fenwick tree cover only preceding elements, so nodes
+	// up to pos_ are still valid and the rest is built in one pass, each node
+	// adding itself to its parent once its own children are in; nodes
+	// up to pos_ with a parent past it are the ones on prefix_sum() path
+	void rebuild( int pos_ ) {
+		int n( size() );
+		_columns.resize( n + 1 );
+		_controls.resize( n + 1 );
+		for ( int i( pos_ ); i < n; ++ i ) {
+			_columns[i + 1] = column_width( _widths[i] );
+			_controls[i + 1] = is_control( _widths[i] );
+		}
+		for ( int i( pos_ ); i > 0; i -= ( i & -i ) ) {
+			add_to_parent( i, n );
+		}
+		for ( int i( pos_ ); i < n; ++ i ) {
+			add_to_parent( i + 1, n );
+		}
+	}
+	void add_to_parent( int node_, int size_ ) {
+		int parent( node_ + ( node_ & -node_ ) );
+		if ( parent <= size_ ) {
+			_columns[parent] += _columns[node_];
+			_controls[parent] += _controls[node_];
+		}
+	}
+};
+
+}
+
+#endif
+
@@ -2,6 +2,7 @@
 #include <string>
 #include <cstring>
 #include <cctype>
+#include <cstdint>
 #include <locale.h>
 
 #include "conversion.hxx"
@@ -10,6 +11,18 @@
 #define strdup _strdup
 #endif
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+#define REPLXX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* AVX2 kernels are compiled with function level target attribute
+ * and selected at run time, so no special compiler flags are needed. */
+#if defined( REPLXX_SSE2 ) && defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define REPLXX_AVX2 1
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 namespace replxx {
@@ -41,17 +54,234 @@ bool is8BitEncoding( is_8bit_encoding() );
 
 }
 
+namespace {
+
+/*
+ * ASCII fast path of UTF-8 <-> UTF-32 conversion.
+ *
+ * Kernels copy characters from the start of the source as long
+ * as they are 7-bit ASCII and return number of characters copied,
+ * the rest is left to the ConvertUTF routines.
+ *
+ * In text mixing ASCII and other characters ASCII runs are short,
+ * a kernel call and a ConvertUTF call for each of them would cost
+ * more than converting all of it with ConvertUTF.  After MIXED_RUNS
+ * ASCII runs in a row shorter than MIXED_RUN, next MIXED_CHUNK characters
+ * (or bytes), and the rest of non-ASCII run they end in, go to a single
+ * ConvertUTF call.  Mostly ASCII text rarely has that many short runs
+ * in a row, so it stays on the fast path.
+ */
+size_t const MIXED_RUN = 16;
+int const MIXED_RUNS = 4;
+ptrdiff_t const MIXED_CHUNK = 64;
+
+typedef size_t (*widen_ascii_t)( char32_t*, char const*, size_t );
+typedef size_t (*narrow_ascii_t)( char*, char32_t const*, size_t );
+
+size_t widen_ascii_scalar( char32_t* dst_, char const* src_, size_t len_ ) {
+	size_t i( 0 );
+	while ( ( i < len_ ) && ! ( src_[i] & 0x80 ) ) {
+		dst_[i] = static_cast<char32_t>( src_[i] );
+		++ i;
+	}
+	return ( i );
+}
+
+size_t narrow_ascii_scalar( char* dst_, char32_t const* src_, size_t len_ ) {
+	size_t i( 0 );
+	while ( ( i < len_ ) && ( src_[i] < 0x80 ) ) {
+		dst_[i] = static_cast<char>( src_[i] );
+		++ i;
+	}
+	return ( i );
+}
+
+#ifdef REPLXX_SSE2
+
+size_t widen_ascii_sse2( char32_t* dst_, char const* src_, size_t len_ ) {
+	__m128i const zero( _mm_setzero_si128() );
+	size_t i( 0 );
+	for ( ; ( i + 16 ) <= len_; i += 16 ) {
+		__m128i bytes( _mm_loadu_si128( reinterpret_cast<__m128i const*>( src_ + i ) ) );
+		if ( _mm_movemask_epi8( bytes ) != 0 ) {
+			break;
+		}
+		__m128i low( _mm_unpacklo_epi8( bytes, zero ) );
+		__m128i high( _mm_unpackhi_epi8( bytes, zero ) );
+		__m128i* out( reinterpret_cast<__m128i*>( dst_ + i ) );
+		_mm_storeu_si128( out,     _mm_unpacklo_epi16( low, zero ) );
+		_mm_storeu_si128( out + 1, _mm_unpackhi_epi16( low, zero ) );
+		_mm_storeu_si128( out + 2, _mm_unpacklo_epi16( high, zero ) );
+		_mm_storeu_si128( out + 3, _mm_unpackhi_epi16( high, zero ) );
+	}
+	return ( i + widen_ascii_scalar( dst_ + i, src_ + i, len_ - i ) );
+}
+
+size_t narrow_ascii_sse2( char* dst_, char32_t const* src_, size_t len_ ) {
+	__m128i const nonAscii( _mm_set1_epi32( ~0x7f ) );
+	size_t i( 0 );
+	for ( ; ( i + 16 ) <= len_; i += 16 ) {
+		__m128i const* in( reinterpret_cast<__m128i const*>( src_ + i ) );
+		__m128i a( _mm_loadu_si128( in ) );
+		__m128i b( _mm_loadu_si128( in + 1 ) );
+		__m128i c( _mm_loadu_si128( in + 2 ) );
+		__m128i d( _mm_loadu_si128( in + 3 ) );
+		__m128i any( _mm_and_si128( _mm_or_si128( _mm_or_si128( a, b ), _mm_or_si128( c, d ) ), nonAscii ) );
+		if ( _mm_movemask_epi8( _mm_cmpeq_epi32( any, _mm_setzero_si128() ) ) != 0xffff ) {
+			break;
+		}
+		// values are below 128 so signed saturation is a plain narrowing
+		__m128i bytes( _mm_packus_epi16( _mm_packs_epi32( a, b ), _mm_packs_epi32( c, d ) ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( dst_ + i ), bytes );
+	}
+	return ( i + narrow_ascii_scalar( dst_ + i, src_ + i, len_ - i ) );
+}
+
+#endif
+
+#ifdef REPLXX_AVX2
+
+__attribute__(( target( "avx2" ) ))
+size_t widen_ascii_avx2( char32_t* dst_, char const* src_, size_t len_ ) {
+	size_t i( 0 );
+	for ( ; ( i + 32 ) <= len_; i += 32 ) {
+		__m256i bytes( _mm256_loadu_si256( reinterpret_cast<__m256i const*>( src_ + i ) ) );
+		if ( _mm256_movemask_epi8( bytes ) != 0 ) {
+			break;
+		}
+		__m128i low( _mm256_castsi256_si128( bytes ) );
+		__m128i high( _mm256_extracti128_si256( bytes, 1 ) );
+		__m256i* out( reinterpret_cast<__m256i*>( dst_ + i ) );
+		_mm256_storeu_si256( out,     _mm256_cvtepu8_epi32( low ) );
+		_mm256_storeu_si256( out + 1, _mm256_cvtepu8_epi32( _mm_srli_si128( low, 8 ) ) );
+		_mm256_storeu_si256( out + 2, _mm256_cvtepu8_epi32( high ) );
+		_mm256_storeu_si256( out + 3, _mm256_cvtepu8_epi32( _mm_srli_si128( high, 8 ) ) );
+	}
+	// upper halves of registers are left dirty, SSE code would stall on them
+	_mm256_zeroupper();
+	return ( i + widen_ascii_sse2( dst_ + i, src_ + i, len_ - i ) );
+}
+
+__attribute__(( target( "avx2" ) ))
+size_t narrow_ascii_avx2( char* dst_, char32_t const* src_, size_t len_ ) {
+	__m256i const nonAscii( _mm256_set1_epi32( ~0x7f ) );
+	// packs work within 128 bit lanes, this puts 4 byte groups back in order
+	__m256i const order( _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 ) );
+	size_t i( 0 );
+	for ( ; ( i + 32 ) <= len_; i += 32 ) {
+		__m256i const* in( reinterpret_cast<__m256i const*>( src_ + i ) );
+		__m256i a( _mm256_loadu_si256( in ) );
+		__m256i b( _mm256_loadu_si256( in + 1 ) );
+		__m256i c( _mm256_loadu_si256( in + 2 ) );
+		__m256i d( _mm256_loadu_si256( in + 3 ) );
+		__m256i any( _mm256_or_si256( _mm256_or_si256( a, b ), _mm256_or_si256( c, d ) ) );
+		if ( ! _mm256_testz_si256( any, nonAscii ) ) {
+			break;
+		}
+		__m256i bytes( _mm256_packus_epi16( _mm256_packs_epi32( a, b ), _mm256_packs_epi32( c, d ) ) );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( dst_ + i ), _mm256_permutevar8x32_epi32( bytes, order ) );
+	}
+	// upper halves of registers are left dirty, SSE code would stall on them
+	_mm256_zeroupper();
+	return ( i + narrow_ascii_sse2( dst_ + i, src_ + i, len_ - i ) );
+}
+
+#endif
+
+struct AsciiKernels {
+	widen_ascii_t widen;
+	narrow_ascii_t narrow;
+};
+
+AsciiKernels select_ascii_kernels( void ) {
+#ifdef REPLXX_AVX2
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx2" ) ) {
+		return ( AsciiKernels{ widen_ascii_avx2, narrow_ascii_avx2 } );
+	}
+#endif
+#ifdef REPLXX_SSE2
+	return ( AsciiKernels{ widen_ascii_sse2, narrow_ascii_sse2 } );
+#else
+	return ( AsciiKernels{ widen_ascii_scalar, narrow_ascii_scalar } );
+#endif
+}
+
+AsciiKernels& ascii_kernels( void ) {
+	static AsciiKernels kernels( select_ascii_kernels() );
+	return ( kernels );
+}
+
+}
+
+bool use_simd( SIMD simd_ ) {
+	switch ( simd_ ) {
+		case SIMD::NONE:
+			ascii_kernels() = AsciiKernels{ widen_ascii_scalar, narrow_ascii_scalar };
+			return ( true );
+#ifdef REPLXX_SSE2
+		case SIMD::SSE2:
+			ascii_kernels() = AsciiKernels{ widen_ascii_sse2, narrow_ascii_sse2 };
+			return ( true );
+#endif
+#ifdef REPLXX_AVX2
+		case SIMD::AVX2:
+			__builtin_cpu_init();
+			if ( ! __builtin_cpu_supports( "avx2" ) ) {
+				return ( false );
+			}
+			ascii_kernels() = AsciiKernels{ widen_ascii_avx2, narrow_ascii_avx2 };
+			return ( true );
+#endif
+		default:
+			return ( false );
+	}
+}
+
 ConversionResult copyString8to32(char32_t* dst, size_t dstSize,
 																				size_t& dstCount, const char* src) {
 	ConversionResult res = ConversionResult::conversionOK;
 	if ( ! locale::is8BitEncoding ) {
+		widen_ascii_t widen( ascii_kernels().widen );
 		const UTF8* sourceStart = reinterpret_cast<const UTF8*>(src);
 		const UTF8* sourceEnd = sourceStart + strlen(src);
 		UTF32* targetStart = reinterpret_cast<UTF32*>(dst);
 		UTF32* targetEnd = targetStart + dstSize;
 
-		res = ConvertUTF8toUTF32(
-				&sourceStart, sourceEnd, &targetStart, targetEnd, lenientConversion);
+		int shortRuns( 0 );
+		while ( sourceStart < sourceEnd ) {
+			size_t ascii( widen(
+				reinterpret_cast<char32_t*>( targetStart ), reinterpret_cast<char const*>( sourceStart ),
+				static_cast<size_t>( min( sourceEnd - sourceStart, targetEnd - targetStart ) )
+			) );
+			sourceStart += ascii;
+			targetStart += ascii;
+			if ( sourceStart == sourceEnd ) {
+				break;
+			}
+			if ( targetStart == targetEnd ) {
+				res = targetExhausted;
+				break;
+			}
+			// multi-byte sequences never contain ASCII bytes,
+			// so text up to any ASCII byte can be converted on its own
+			const UTF8* runEnd( sourceStart );
+			shortRuns = ascii < MIXED_RUN ? shortRuns + 1 : 0;
+			if ( shortRuns >= MIXED_RUNS ) {
+				runEnd += min( sourceEnd - sourceStart, MIXED_CHUNK );
+			}
+			while ( ( runEnd < sourceEnd ) && ( *runEnd & 0x80 ) ) {
+				++ runEnd;
+			}
+			res = ConvertUTF8toUTF32(
+					&sourceStart, runEnd, &targetStart, targetEnd, lenientConversion);
+			if ( res != conversionOK ) {
+				if ( ( res == sourceExhausted ) && ( runEnd < sourceEnd ) ) {
+					res = sourceIllegal;
+				}
+				break;
+			}
+		}
 
 		if (res == conversionOK) {
 			dstCount = targetStart - reinterpret_cast<UTF32*>(dst);
@@ -80,11 +310,34 @@ ConversionResult copyString8to32(char32_t* dst, size_t dstSize,
 size_t strlen32(const char32_t* str) {
 	const char32_t* ptr = str;
 
+#if defined( REPLXX_SSE2 ) && ! defined( __SANITIZE_ADDRESS__ )
+	// aligned loads never cross a page boundary,
+	// so reading past the terminator within one is safe
+	while ( ( reinterpret_cast<uintptr_t>( ptr ) & 15 ) != 0 ) {
+		if ( ! *ptr ) {
+			return ptr - str;
+		}
+		++ptr;
+	}
+	__m128i const zero( _mm_setzero_si128() );
+	while ( true ) {
+		int mask( _mm_movemask_epi8( _mm_cmpeq_epi32( _mm_load_si128( reinterpret_cast<__m128i const*>( ptr ) ), zero ) ) );
+		if ( mask != 0 ) {
+			int bit( 0 );
+			while ( ! ( mask & ( 1 << bit ) ) ) {
+				++ bit;
+			}
+			return ( ptr - str ) + bit / 4;
+		}
+		ptr += 4;
+	}
+#else
 	while (*ptr) {
 		++ptr;
 	}
 
 	return ptr - str;
+#endif
 }
 
 size_t strlen8(const char8_t* str) {
@@ -95,6 +348,44 @@ char8_t* strdup8(const char* src) {
 	return reinterpret_cast<char8_t*>(strdup(src));
 }
 
+int strlen8( char const* str, int size ) {
+	if ( locale::is8BitEncoding ) {
+		return ( size );
+	}
+	int len( 0 );
+	for ( int i( 0 ); i < size; ++ i ) {
+		if ( ( str[i] & 0xc0 ) != 0x80 ) {
+			++ len;
+		}
+	}
+	return ( len );
+}
+
+int char_offset8( char const* str, int size, int pos ) {
+	if ( locale::is8BitEncoding ) {
+		return ( min( pos, size ) );
+	}
+	int offset( 0 );
+	for ( int i( 0 ); offset < size; ++ offset ) {
+		if ( ( str[offset] & 0xc0 ) != 0x80 ) {
+			if ( i == pos ) {
+				break;
+			}
+			++ i;
+		}
+	}
+	return ( offset );
+}
+
+int char_boundary8( char const* str, int pos ) {
+	if ( ! locale::is8BitEncoding ) {
+		while ( ( pos > 0 ) && ( ( str[pos] & 0xc0 ) == 0x80 ) ) {
+			-- pos;
+		}
+	}
+	return ( pos );
+}
+
 
 void copyString32to16(char16_t* dst, size_t dstSize, size_t* dstCount,
 														 const char32_t* src, size_t srcSize) {
@@ -118,13 +409,45 @@ void copyString32to16(char16_t* dst, size_t dstSize, size_t* dstCount,
 void copyString32to8(char* dst, size_t dstSize, size_t* dstCount,
 														const char32_t* src, size_t srcSize) {
 	if ( ! locale::is8BitEncoding ) {
+		narrow_ascii_t narrow( ascii_kernels().narrow );
 		const UTF32* sourceStart = reinterpret_cast<const UTF32*>(src);
 		const UTF32* sourceEnd = sourceStart + srcSize;
 		UTF8* targetStart = reinterpret_cast<UTF8*>(dst);
 		UTF8* targetEnd = targetStart + dstSize;
 
-		ConversionResult res = ConvertUTF32toUTF8(
-				&sourceStart, sourceEnd, &targetStart, targetEnd, lenientConversion);
+		ConversionResult res( conversionOK );
+		int shortRuns( 0 );
+		while ( sourceStart < sourceEnd ) {
+			size_t ascii( narrow(
+				reinterpret_cast<char*>( targetStart ), reinterpret_cast<char32_t const*>( sourceStart ),
+				static_cast<size_t>( min( sourceEnd - sourceStart, targetEnd - targetStart ) )
+			) );
+			sourceStart += ascii;
+			targetStart += ascii;
+			if ( sourceStart == sourceEnd ) {
+				break;
+			}
+			if ( targetStart == targetEnd ) {
+				res = targetExhausted;
+				break;
+			}
+			const UTF32* runEnd( sourceStart );
+			shortRuns = ascii < MIXED_RUN ? shortRuns + 1 : 0;
+			if ( shortRuns >= MIXED_RUNS ) {
+				runEnd += min( sourceEnd - sourceStart, MIXED_CHUNK );
+			}
+			while ( ( runEnd < sourceEnd ) && ( *runEnd >= 0x80 ) ) {
+				++ runEnd;
+			}
+			ConversionResult runRes( ConvertUTF32toUTF8(
+					&sourceStart, runEnd, &targetStart, targetEnd, lenientConversion) );
+			if ( runRes != conversionOK ) {
+				res = runRes;
+				if ( runRes == targetExhausted ) {
+					break;
+				}
+			}
+		}
 
 		if (res == conversionOK) {
 			*dstCount = targetStart - reinterpret_cast<UTF8*>(dst);
@@ -13,10 +13,22 @@ void copyString32to8( char* dst, size_t dstSize, size_t* dstCount, char32_t cons
 void copyString32to8( char* dst, size_t dstLen, char32_t const* src );
 void copyString32to16( char16_t* dst, size_t dstSize, size_t* dstCount, char32_t const* src, size_t srcSize );
 size_t strlen8( char8_t const* str );
+// number of characters in first size bytes of UTF-8 encoded str
+int strlen8( char const* str, int size );
+// start of character containing byte at pos
+int char_boundary8( char const* str, int pos );
+// byte offset of character at pos in first size bytes of UTF-8 encoded str
+int char_offset8( char const* str, int size, int pos );
 char8_t* strdup8( char const* src );
 void copyString32( char32_t* dst, char32_t const* src, size_t len );
 int strncmp32( char32_t const* left, char32_t const* right, size_t len );
 
+// instruction set of ASCII fast paths in UTF-8 <-> UTF-32 conversion,
+// best one supported by the processor is used by default
+enum class SIMD { NONE, SSE2, AVX2 };
+// switch fast paths to given instruction set, false if it is not available
+bool use_simd( SIMD );
+
 namespace locale {
 extern bool is8BitEncoding;
 }
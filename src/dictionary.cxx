@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cstring>
+
+#include "dictionary.hxx"
+
+using namespace std;
+
+namespace replxx {
+
+/*
+ * Order words added since last call and drop duplicates,
+ * the buffer is rebuilt so words are stored in order.
+ */
+void Dictionary::sort( void ) {
+	char const* data( _buffer.data() );
+	vector<int> order( _starts );
+	std::sort(
+		order.begin(), order.end(),
+		[data]( int left_, int right_ ) {
+			return ( strcmp( data + left_, data + right_ ) < 0 );
+		}
+	);
+	order.erase(
+		unique(
+			order.begin(), order.end(),
+			[data]( int left_, int right_ ) {
+				return ( strcmp( data + left_, data + right_ ) == 0 );
+			}
+		),
+		order.end()
+	);
+	string buffer;
+	buffer.reserve( _buffer.size() );
+	_starts.clear();
+	for ( int start : order ) {
+		_starts.push_back( static_cast<int>( buffer.size() ) );
+		buffer.append( data + start ).push_back( 0 );
+	}
+	_buffer.swap( buffer );
+}
+
+/*
+ * Range [first_, last_) of words starting with given prefix.
+ */
+void Dictionary::find( char const* prefix_, int size_, int& first_, int& last_ ) const {
+	char const* data( _buffer.data() );
+	size_t size( static_cast<size_t>( size_ ) );
+	vector<int>::const_iterator first(
+		lower_bound(
+			_starts.begin(), _starts.end(), prefix_,
+			[data, size]( int word_, char const* prefix ) {
+				return ( strncmp( data + word_, prefix, size ) < 0 );
+			}
+		)
+	);
+	vector<int>::const_iterator last(
+		upper_bound(
+			first, _starts.end(), prefix_,
+			[data, size]( char const* prefix, int word_ ) {
+				return ( strncmp( prefix, data + word_, size ) < 0 );
+			}
+		)
+	);
+	first_ = static_cast<int>( first - _starts.begin() );
+	last_ = static_cast<int>( last - _starts.begin() );
+}
+
+}
+
@@ -0,0 +1,48 @@
+#ifndef REPLXX_DICTIONARY_HXX_INCLUDED
+#define REPLXX_DICTIONARY_HXX_INCLUDED 1
+
+#include <vector>
+#include <string>
+
+namespace replxx {
+
+/*! \brief Sorted set of words offered as completions and hints.
+ *
+ * Words are kept back to back in a single buffer, in UTF-8 byte order
+ * and without duplicates, so all words starting with given prefix
+ * form a range found with two binary searches.
+ */
+class Dictionary {
+	std::string _buffer;      // words, each followed by a terminator
+	std::vector<int> _starts; // offset of each word in _buffer
+public:
+	Dictionary( void )
+		: _buffer()
+		, _starts() {
+	}
+	void add( char const* word_, int size_ ) {
+		_starts.push_back( static_cast<int>( _buffer.size() ) );
+		_buffer.append( word_, static_cast<size_t>( size_ ) ).push_back( 0 );
+	}
+	void sort( void );
+	void find( char const* prefix_, int size_, int& first_, int& last_ ) const;
+	int count( void ) const {
+		return ( static_cast<int>( _starts.size() ) );
+	}
+	char const* get( int index_ ) const {
+		return ( _buffer.data() + _starts[index_] );
+	}
+	int size( int index_ ) const {
+		int end( index_ + 1 < count() ? _starts[index_ + 1] : static_cast<int>( _buffer.size() ) );
+		return ( end - _starts[index_] - 1 );
+	}
+	void clear( void ) {
+		_buffer.clear();
+		_starts.clear();
+	}
+};
+
+}
+
+#endif
+
@@ -185,6 +185,46 @@ static CharacterDispatchRoutine escLeftBracket8Routines[] = {endKeyRoutine,
 static CharacterDispatch escLeftBracket8Dispatch = {1, "~",
 																										escLeftBracket8Routines};
 
+// Handle ESC [ 2 <more stuff> escape sequences, bracketed paste markers
+//
+static char32_t pasteStartRoutine(char32_t) {
+	return thisKeyMetaCtrl | PASTE_START;
+}
+static char32_t pasteFinishRoutine(char32_t) {
+	return thisKeyMetaCtrl | PASTE_FINISH;
+}
+static CharacterDispatchRoutine escLeftBracket200Routines[] = {
+		pasteStartRoutine, escFailureRoutine};
+static CharacterDispatch escLeftBracket200Dispatch = {1, "~",
+																											escLeftBracket200Routines};
+static CharacterDispatchRoutine escLeftBracket201Routines[] = {
+		pasteFinishRoutine, escFailureRoutine};
+static CharacterDispatch escLeftBracket201Dispatch = {1, "~",
+																											escLeftBracket201Routines};
+static char32_t escLeftBracket200Routine(char32_t c) {
+	c = readUnicodeCharacter();
+	if (c == 0) return 0;
+	return doDispatch(c, escLeftBracket200Dispatch);
+}
+static char32_t escLeftBracket201Routine(char32_t c) {
+	c = readUnicodeCharacter();
+	if (c == 0) return 0;
+	return doDispatch(c, escLeftBracket201Dispatch);
+}
+static CharacterDispatchRoutine escLeftBracket20Routines[] = {
+		escLeftBracket200Routine, escLeftBracket201Routine, escFailureRoutine};
+static CharacterDispatch escLeftBracket20Dispatch = {2, "01",
+																										 escLeftBracket20Routines};
+static char32_t escLeftBracket20Routine(char32_t c) {
+	c = readUnicodeCharacter();
+	if (c == 0) return 0;
+	return doDispatch(c, escLeftBracket20Dispatch);
+}
+static CharacterDispatchRoutine escLeftBracket2Routines[] = {
+		escLeftBracket20Routine, escFailureRoutine};	// ESC [ 2 ~ is Insert key, unused
+static CharacterDispatch escLeftBracket2Dispatch = {1, "0",
+																										escLeftBracket2Routines};
+
 // Handle ESC [ <digit> escape sequences
 //
 static char32_t escLeftBracket0Routine(char32_t c) {
@@ -196,7 +236,9 @@ static char32_t escLeftBracket1Routine(char32_t c) {
 	return doDispatch(c, escLeftBracket1Dispatch);
 }
 static char32_t escLeftBracket2Routine(char32_t c) {
-	return escFailureRoutine(c);	// Insert key, unused
+	c = readUnicodeCharacter();
+	if (c == 0) return 0;
+	return doDispatch(c, escLeftBracket2Dispatch);
 }
 static char32_t escLeftBracket3Routine(char32_t c) {
 	c = readUnicodeCharacter();
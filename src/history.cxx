@@ -1,10 +1,15 @@
 #include <fstream>
+#include <iterator>
 #include <cstring>
+#include <algorithm>
+#include <limits>
 
 #ifndef _WIN32
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #endif /* _WIN32 */
 
@@ -16,8 +21,52 @@ namespace replxx {
 
 static int const REPLXX_DEFAULT_HISTORY_MAX_LEN( 1000 );
 
+namespace {
+
+// keys of the incremental search index,
+// single characters are tagged with a value that is not a valid code point
+inline unsigned long long unigram_key( char32_t c_ ) {
+	return ( ( 0x200000ULL << 32 ) | c_ );
+}
+
+inline unsigned long long bigram_key( char32_t first_, char32_t second_ ) {
+	return ( ( static_cast<unsigned long long>( first_ ) << 32 ) | second_ );
+}
+
+/*
+ * Find text in a line starting at given position and going in given direction.
+ * Returns position of the match or -1.
+ */
+int find_in_line( Utf32String const& line_, char32_t const* text_, int len_, int from_, bool forward_ ) {
+	int last( static_cast<int>( line_.length() ) - len_ );
+	if ( forward_ ) {
+		for ( int pos( max( from_, 0 ) ); pos <= last; ++ pos ) {
+			if ( memcmp( line_.get() + pos, text_, sizeof ( char32_t ) * len_ ) == 0 ) {
+				return ( pos );
+			}
+		}
+	} else {
+		for ( int pos( min( from_, last ) ); pos >= 0; -- pos ) {
+			if ( memcmp( line_.get() + pos, text_, sizeof ( char32_t ) * len_ ) == 0 ) {
+				return ( pos );
+			}
+		}
+	}
+	return ( -1 );
+}
+
+}
+
 History::History( void )
 	: _data()
+	, _unicodeData()
+	, _searchIndex()
+	, _prefixTree()
+	, _indexed( false )
+	, _serialBase( 0 )
+	, _syncFile()
+	, _syncedSerial( 0 )
+	, _fileLines( 0 )
 	, _maxSize( REPLXX_DEFAULT_HISTORY_MAX_LEN )
 	, _index( 0 )
 	, _previousIndex( -2 )
@@ -27,12 +76,127 @@ History::History( void )
 void History::add( std::string const& line ) {
 	if ( ( _maxSize > 0 ) && ( _data.empty() || ( line != _data.back() ) ) ) {
 		if ( size() == _maxSize ) {
-			_data.erase( _data.begin() );
+			pop_front();
 			if ( -- _previousIndex < -1 ) {
 				_previousIndex = -2;
 			}
 		}
-		_data.push_back( line );
+		push_back( line );
+	}
+}
+
+void History::drop_last( void ) {
+	pop_back();
+}
+
+void History::update_last( std::string const& line_ ) {
+	pop_back();
+	push_back( line_ );
+}
+
+void History::push_back( std::string const& line_ ) {
+	_data.push_back( line_ );
+	if ( _indexed ) {
+		add_to_indexes( size() - 1 );
+	}
+}
+
+void History::pop_front( void ) {
+	if ( _indexed ) {
+		unindex_line( _serialBase, _unicodeData.front(), true );
+		_prefixTree.erase( _data.front(), true );
+		_unicodeData.pop_front();
+	}
+	_data.pop_front();
+	++ _serialBase;
+}
+
+void History::pop_back( void ) {
+	if ( ( _serialBase + size() - 1 ) < _syncedSerial ) {
+		// line is in the file already, next sync must rewrite it
+		_syncFile.clear();
+	}
+	if ( _indexed ) {
+		int serial( _serialBase + size() - 1 );
+		unindex_line( serial, _unicodeData.back(), false );
+		_prefixTree.erase( _data.back(), false );
+		_unicodeData.pop_back();
+	}
+	_data.pop_back();
+}
+
+void History::add_to_indexes( int index_ ) {
+	int serial( _serialBase + index_ );
+	_unicodeData.emplace_back( _data[index_].c_str() );
+	index_line( serial, _unicodeData.back() );
+	_prefixTree.insert( _data[index_], serial );
+}
+
+/*
+ * Search indexes are built on first use so that loading history
+ * does not pay for them, afterwards they are maintained incrementally.
+ */
+void History::build_indexes( void ) {
+	if ( _indexed ) {
+		return;
+	}
+	for ( int i( 0 ), count( size() ); i < count; ++ i ) {
+		add_to_indexes( i );
+	}
+	_indexed = true;
+}
+
+void History::index_line( int serial_, Utf32String const& line_ ) {
+	int len( static_cast<int>( line_.length() ) );
+	for ( int i( 0 ); i < len; ++ i ) {
+		add_posting( unigram_key( line_[i] ), serial_ );
+		if ( ( i + 1 ) < len ) {
+			add_posting( bigram_key( line_[i], line_[i + 1] ), serial_ );
+		}
+	}
+}
+
+/*
+ * Remove a line from the search index,
+ * only the oldest ( front_ == true ) or the newest line can be removed.
+ */
+void History::unindex_line( int serial_, Utf32String const& line_, bool front_ ) {
+	int len( static_cast<int>( line_.length() ) );
+	for ( int i( 0 ); i < len; ++ i ) {
+		remove_posting( unigram_key( line_[i] ), serial_, front_ );
+		if ( ( i + 1 ) < len ) {
+			remove_posting( bigram_key( line_[i], line_[i + 1] ), serial_, front_ );
+		}
+	}
+}
+
+void History::add_posting( unsigned long long key_, int serial_ ) {
+	std::vector<int>& serials( _searchIndex[key_].serials );
+	if ( serials.empty() || ( serials.back() != serial_ ) ) {
+		serials.push_back( serial_ );
+	}
+}
+
+void History::remove_posting( unsigned long long key_, int serial_, bool front_ ) {
+	search_index_t::iterator it( _searchIndex.find( key_ ) );
+	if ( it == _searchIndex.end() ) {
+		return;
+	}
+	Postings& p( it->second );
+	if ( front_ ) {
+		if ( p.serials[p.start] == serial_ ) {
+			++ p.start;
+			// drop evicted serials once they make up half of the list
+			if ( ( p.start * 2 ) >= static_cast<int>( p.serials.size() ) ) {
+				p.serials.erase( p.serials.begin(), p.serials.begin() + p.start );
+				p.start = 0;
+			}
+		}
+	} else if ( p.serials.back() == serial_ ) {
+		p.serials.pop_back();
+	}
+	if ( p.start == static_cast<int>( p.serials.size() ) ) {
+		_searchIndex.erase( it );
 	}
 }
 
@@ -41,45 +205,178 @@ int History::save( std::string const& filename ) {
 	mode_t old_umask = umask( S_IXUSR | S_IRWXG| S_IRWXO );
 #endif
 	ofstream histFile( filename );
+#ifndef _WIN32
+	umask( old_umask );
+#endif
 	if ( ! histFile ) {
 		return ( -1 );
 	}
 #ifndef _WIN32
-	umask( old_umask );
 	chmod( filename.c_str(), S_IRUSR | S_IWUSR );
 #endif
-	for ( string const& h : _data ) {
+	int lines( 0 );
+	string buf( serialize( 0, lines ) );
+	if ( ! histFile.write( buf.data(), static_cast<streamsize>( buf.length() ) ).flush() ) {
+		return ( -1 );
+	}
+	mark_synced( filename, lines );
+	return ( 0 );
+}
+
+/*
+ * Append entries added since last save, load or sync to the history file.
+ *
+ * The file is rewritten instead when it was not synced with this history yet,
+ * when already persisted entries were dropped, or when appending would
+ * make it grow past twice the history size.
+ */
+int History::sync( std::string const& filename ) {
+	int first( max( _syncedSerial - _serialBase, 0 ) );
+	int pending( size() - first );
+	if ( ( filename != _syncFile ) || ( ( _fileLines + pending ) > ( 2 * _maxSize ) ) ) {
+		return ( save( filename ) );
+	}
+	if ( pending <= 0 ) {
+		return ( 0 );
+	}
+#ifndef _WIN32
+	mode_t old_umask = umask( S_IXUSR | S_IRWXG| S_IRWXO );
+#endif
+	ofstream histFile( filename, ios::app );
+#ifndef _WIN32
+	umask( old_umask );
+#endif
+	if ( ! histFile ) {
+		return ( -1 );
+	}
+	int lines( 0 );
+	string buf( serialize( first, lines ) );
+	if ( ! histFile.write( buf.data(), static_cast<streamsize>( buf.length() ) ).flush() ) {
+		_syncFile.clear();
+		return ( -1 );
+	}
+	mark_synced( filename, _fileLines + lines );
+	return ( 0 );
+}
+
+string History::serialize( int from_, int& lines_ ) const {
+	string buf;
+	for ( int i( from_ ), count( size() ); i < count; ++ i ) {
+		string const& h( _data[i] );
 		if ( ! h.empty() ) {
-			histFile << h << endl;
+			buf.append( h ).push_back( '\n' );
+			++ lines_;
 		}
 	}
-	return ( 0 );
+	return ( buf );
+}
+
+void History::mark_synced( std::string const& filename_, int fileLines_ ) {
+	_syncFile = filename_;
+	_syncedSerial = _serialBase + size();
+	_fileLines = fileLines_;
 }
 
 int History::load( std::string const& filename ) {
-	ifstream histFile( filename );
+#ifndef _WIN32
+	// regular files are mapped into memory, no copy of the contents is made,
+	// anything that cannot be mapped (pipes, procfs, some FUSE file systems)
+	// is read as a stream below
+	int fd( open( filename.c_str(), O_RDONLY ) );
+	if ( fd < 0 ) {
+		return ( -1 );
+	}
+	struct stat st;
+	if ( ( fstat( fd, &st ) == 0 ) && S_ISREG( st.st_mode ) && ( st.st_size > 0 ) ) {
+		size_t size( static_cast<size_t>( st.st_size ) );
+		void* data( mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 ) );
+		if ( data != MAP_FAILED ) {
+			close( fd );
+			bool wasEmpty( _data.empty() );
+			int lines( load( static_cast<char const*>( data ), size ) );
+			munmap( data, size );
+			if ( wasEmpty ) {
+				mark_synced( filename, lines );
+			}
+			return ( 0 );
+		}
+	}
+	close( fd );
+#endif
+	ifstream histFile( filename, ios::binary );
 	if ( ! histFile ) {
 		return ( -1 );
 	}
-	string line;
-	while ( getline( histFile, line ).good() ) {
-		string::size_type eol( line.find_first_of( "\r\n" ) );
-		if ( eol != string::npos ) {
-			line.erase( eol );
+	std::vector<char> data( ( istreambuf_iterator<char>( histFile ) ), istreambuf_iterator<char>() );
+	bool wasEmpty( _data.empty() );
+	int lines( load( data.data(), data.size() ) );
+	if ( wasEmpty ) {
+		mark_synced( filename, lines );
+	}
+	return 0;
+}
+
+/*
+ * Add lines from history file contents to history.
+ *
+ * Line boundaries are found with memchr(), which is vectorized in any
+ * decent C library.  Only the lines that will survive eviction are copied.
+ * Returns number of non-empty lines in the file.
+ */
+int History::load( char const* data_, size_t size_ ) {
+	if ( _maxSize <= 0 ) {
+		return ( 0 );
+	}
+	int fileLines( 0 );
+	typedef std::pair<char const*, size_t> span_t;
+	std::vector<span_t> lines;
+	char const* end( data_ + size_ );
+	char const* prevLine( nullptr );
+	size_t prevLen( 0 );
+	if ( ! _data.empty() ) {
+		prevLine = _data.back().data();
+		prevLen = _data.back().length();
+	}
+	for ( char const* p( data_ ); p < end; ) {
+		char const* eol( static_cast<char const*>( memchr( p, '\n', static_cast<size_t>( end - p ) ) ) );
+		char const* next( eol ? eol + 1 : end );
+		if ( ! eol ) {
+			eol = end;
 		}
-		if ( ! line.empty() ) {
-			add( line );
+		char const* cr( static_cast<char const*>( memchr( p, '\r', static_cast<size_t>( eol - p ) ) ) );
+		size_t len( static_cast<size_t>( ( cr ? cr : eol ) - p ) );
+		if ( len > 0 ) {
+			++ fileLines;
 		}
+		// same rules as add(): no empty lines, no consecutive duplicates
+		if ( ( len > 0 ) && ( ! prevLine || ( len != prevLen ) || ( memcmp( p, prevLine, len ) != 0 ) ) ) {
+			lines.push_back( span_t( p, len ) );
+			prevLine = p;
+			prevLen = len;
+		}
+		p = next;
 	}
-	return 0;
+	size_t count( lines.size() );
+	size_t skip( 0 );
+	if ( count >= static_cast<size_t>( _maxSize ) ) {
+		// all current entries would get evicted anyway
+		skip = count - _maxSize;
+		while ( ! _data.empty() ) {
+			pop_front();
+		}
+		_previousIndex = -2;
+	}
+	for ( size_t i( skip ); i < count; ++ i ) {
+		add( std::string( lines[i].first, lines[i].second ) );
+	}
+	return ( fileLines );
 }
 
 void History::set_max_size( int size_ ) {
 	if ( size_ >= 0 ) {
 		_maxSize = size_;
-		int curSize( size() );
-		if ( _maxSize < curSize ) {
-			_data.erase( _data.begin(), _data.begin() + ( curSize - _maxSize ) );
+		while ( size() > _maxSize ) {
+			pop_front();
 		}
 	}
 }
@@ -117,19 +414,92 @@ void History::jump( bool start_ ) {
 	_recallMostRecent = true;
 }
 
+/*
+ * Find the nearest line, in history order and wrapping around its ends,
+ * that starts with the prefix and is not equal to whole input.
+ */
 bool History::common_prefix_search( std::string const& prefix_, int prefixSize_, bool back_ ) {
-	int direct( size() + ( back_ ? -1 : 1 ) );
-	int i( ( _index + direct ) % _data.size() );
-	while ( i != _index ) {
-		if ( ( strncmp( prefix_.c_str(), _data[i].c_str(), prefixSize_ ) == 0 )
-			&& ( strcmp( prefix_.c_str(), _data[i].c_str() ) != 0 ) ) {
-			_index = i;
-			_previousIndex = -2;
-			_recallMostRecent = true;
-			return ( true );
-		}
-		i += direct;
-		i %= _data.size();
+	if ( _data.empty() ) {
+		return ( false );
+	}
+	string prefix( prefix_, 0, min( static_cast<size_t>( max( prefixSize_, 0 ) ), prefix_.length() ) );
+	build_indexes();
+	int serial( _serialBase + _index );
+	int found( _prefixTree.nearest( prefix, prefix_, serial, back_ ) );
+	if ( found < 0 ) {
+		found = _prefixTree.nearest( prefix, prefix_, back_ ? numeric_limits<int>::max() : -1, back_ );
+	}
+	if ( ( found < 0 ) || ( found == serial ) ) {
+		return ( false );
+	}
+	_index = found - _serialBase;
+	_previousIndex = -2;
+	_recallMostRecent = true;
+	return ( true );
+}
+
+/**
+ * Find next line containing given text, used by incremental history search.
+ *
+ * Search starts at given position of given line, continues with following
+ * (or preceding) lines.  Only lines that contain all characters pairs
+ * of the text, taken from the search index, are examined.
+ *
+ * @param text_    text to look for
+ * @param len_     length of the text
+ * @param forward_ search direction
+ * @param index_   in: line to start from, out: line with the match
+ * @param pos_     in: position to start from, out: position of the match
+ * @return true iff text was found
+ */
+bool History::search( char32_t const* text_, int len_, bool forward_, int& index_, int& pos_ ) {
+	if ( ( len_ <= 0 ) || _data.empty() ) {
+		return ( false );
+	}
+	build_indexes();
+	int pos( find_in_line( _unicodeData[index_], text_, len_, pos_, forward_ ) );
+	if ( pos >= 0 ) {
+		pos_ = pos;
+		return ( true );
+	}
+	// candidate lines come from the shortest posting list among all keys of the text
+	Postings const* best( nullptr );
+	for ( int i( 0 ); i < ( len_ > 1 ? len_ - 1 : 1 ); ++ i ) {
+		search_index_t::const_iterator it(
+			_searchIndex.find( len_ > 1 ? bigram_key( text_[i], text_[i + 1] ) : unigram_key( text_[i] ) )
+		);
+		if ( it == _searchIndex.end() ) {
+			return ( false );
+		}
+		if ( ! best || ( ( it->second.serials.size() - it->second.start ) < ( best->serials.size() - best->start ) ) ) {
+			best = &it->second;
+		}
+	}
+	std::vector<int>::const_iterator first( best->serials.begin() + best->start );
+	std::vector<int>::const_iterator last( best->serials.end() );
+	int serial( _serialBase + index_ );
+	if ( forward_ ) {
+		for ( std::vector<int>::const_iterator it( upper_bound( first, last, serial ) ); it != last; ++ it ) {
+			int index( *it - _serialBase );
+			pos = find_in_line( _unicodeData[index], text_, len_, 0, true );
+			if ( pos >= 0 ) {
+				index_ = index;
+				pos_ = pos;
+				return ( true );
+			}
+		}
+	} else {
+		for ( std::vector<int>::const_iterator it( lower_bound( first, last, serial ) ); it != first; ) {
+			-- it;
+			int index( *it - _serialBase );
+			Utf32String const& line( _unicodeData[index] );
+			pos = find_in_line( line, text_, len_, static_cast<int>( line.length() ), false );
+			if ( pos >= 0 ) {
+				index_ = index;
+				pos_ = pos;
+				return ( true );
+			}
+		}
 	}
 	return ( false );
 }
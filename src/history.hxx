@@ -1,18 +1,45 @@
 #ifndef REPLXX_HISTORY_HXX_INCLUDED
 #define REPLXX_HISTORY_HXX_INCLUDED 1
 
+#include <deque>
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 #include "conversion.hxx"
+#include "utfstring.hxx"
+#include "prefixtree.hxx"
 
 namespace replxx {
 
 class History {
 public:
-	typedef std::vector<std::string> lines_t;
+	typedef std::deque<std::string> lines_t; // O(1) eviction of the oldest entry
+	typedef std::deque<Utf32String> unicode_lines_t;
+	/*! \brief Serial numbers of history lines containing given character or pair of characters.
+	 *
+	 * Lines get consecutive serial numbers in order of addition so posting lists
+	 * are sorted, serials before `start` belong to lines evicted already.
+	 */
+	struct Postings {
+		std::vector<int> serials;
+		int start;
+		Postings( void )
+			: serials()
+			, start( 0 ) {
+		}
+	};
+	typedef std::unordered_map<unsigned long long, Postings> search_index_t;
 private:
 	lines_t _data;
+	unicode_lines_t _unicodeData; // UTF-32 form of each line for incremental search
+	search_index_t _searchIndex;
+	PrefixTree _prefixTree;       // lines by prefix for common prefix search
+	bool _indexed;                // search indexes and _unicodeData are built
+	int _serialBase;              // serial number of the oldest line
+	std::string _syncFile;        // file this history was last saved to or loaded from
+	int _syncedSerial;            // serial number of the first line not in _syncFile
+	int _fileLines;               // number of lines in _syncFile
 	int _maxSize;
 	int _index;
 	int _previousIndex;
@@ -22,6 +49,7 @@ public:
 	void add( std::string const& line );
 	int save( std::string const& filename );
 	int load( std::string const& filename );
+	int sync( std::string const& filename );
 	void set_max_size( int len );
 	void reset_pos( int = -1 );
 	std::string const& operator[] ( int ) const;
@@ -31,9 +59,7 @@ public:
 	void reset_recall_most_recent( void ) {
 		_recallMostRecent = false;
 	}
-	void drop_last( void ) {
-		_data.pop_back();
-	}
+	void drop_last( void );
 	void commit_index( void ) {
 		_previousIndex = _recallMostRecent ? _index : -2;
 	}
@@ -46,19 +72,34 @@ public:
 	bool is_empty( void ) const {
 		return ( _data.empty() );
 	}
-	void update_last( std::string const& line_ ) {
-		_data.back() = line_;
-	}
+	void update_last( std::string const& line_ );
 	bool move( bool );
 	std::string const& current( void ) const {
 		return ( _data[_index] );
 	}
+	Utf32String const& current_unicode( void ) {
+		build_indexes();
+		return ( _unicodeData[_index] );
+	}
 	void jump( bool );
 	bool common_prefix_search( std::string const&, int, bool );
+	bool search( char32_t const*, int, bool, int&, int& );
 	int size( void ) const {
 		return ( static_cast<int>( _data.size() ) );
 	}
 private:
+	int load( char const*, size_t );
+	std::string serialize( int, int& ) const;
+	void mark_synced( std::string const&, int );
+	void push_back( std::string const& );
+	void pop_front( void );
+	void pop_back( void );
+	void build_indexes( void );
+	void add_to_indexes( int );
+	void index_line( int, Utf32String const& );
+	void unindex_line( int, Utf32String const&, bool );
+	void add_posting( unsigned long long, int );
+	void remove_posting( unsigned long long, int, bool );
 	History( History const& ) = delete;
 	History& operator = ( History const& ) = delete;
 };
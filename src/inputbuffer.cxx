@@ -37,85 +37,249 @@ namespace replxx {
 
 struct PromptBase;
 
-void dynamicRefresh(PromptBase& pi, char32_t* buf32, int len, int pos);
+void dynamicRefresh(OutputBuffer& out, PromptBase& pi, char32_t const* buf32, int len, int pos);
+int mk_wcwidth( char32_t );
 
 #ifndef _WIN32
 extern bool gotResize;
 #endif
 static KillRing killRing;
 
+/*
+ * Prepare for editing a new line, storage allocated
+ * by previous edits is kept for reuse.
+ */
+void InputBuffer::reset( int maxLen_ ) {
+	_maxLen = maxLen_;
+	_len = _pos = _prefix = 0;
+	_buf32[0] = 0;
+	_charWidths.reset( _buf32.get(), 0 );
+	_display.clear();
+	_displayColor = Replxx::Color::DEFAULT;
+	_colorCodeEnd = -1;
+	_screen.frame.clear();
+	_screen.valid = false;
+	_hint.assign( "" );
+	_colors.clear();
+	_editPos = -1;
+	_editRemoved = _editInserted = 0;
+	_utf8.clear();
+	_utf8Chars = _utf8Dirty = 0;
+	_utf8Cut = -1;
+	_hintSelection = -1;
+	_refreshPending = false;
+	_hintsPending = false;
+}
+
 void InputBuffer::preloadBuffer(const char* preloadText) {
-	size_t ucharCount = 0;
-	copyString8to32(_buf32.get(), _buflen + 1, ucharCount, preloadText);
-	recomputeCharacterWidths(_buf32.get(), _charWidths.get(), static_cast<int>(ucharCount));
-	_len = static_cast<int>(ucharCount);
-	_prefix = _pos = static_cast<int>(ucharCount);
+	set_text( preloadText );
+	_prefix = _pos = _len;
 }
 
-char const* ansi_color( Replxx::Color color_ ) {
-	static char const reset[] = "\033[0m";
-	static char const black[] = "\033[0;22;30m";
-	static char const red[] = "\033[0;22;31m";
-	static char const green[] = "\033[0;22;32m";
-	static char const brown[] = "\033[0;22;33m";
-	static char const blue[] = "\033[0;22;34m";
-	static char const magenta[] = "\033[0;22;35m";
-	static char const cyan[] = "\033[0;22;36m";
-	static char const lightgray[] = "\033[0;22;37m";
-
-	static char const* TERM( getenv( "TERM" ) );
-	static bool const has256color( TERM ? ( strstr( TERM, "256" ) != nullptr ) : false );
-	static char const* gray = has256color ? "\033[0;1;90m" : "\033[0;1;30m";
-	static char const* brightred = has256color ? "\033[0;1;91m" : "\033[0;1;31m";
-	static char const* brightgreen = has256color ? "\033[0;1;92m" : "\033[0;1;32m";
-	static char const* yellow = has256color ? "\033[0;1;93m" : "\033[0;1;33m";
-	static char const* brightblue = has256color ? "\033[0;1;94m" : "\033[0;1;34m";
-	static char const* brightmagenta = has256color ? "\033[0;1;95m" : "\033[0;1;35m";
-	static char const* brightcyan = has256color ? "\033[0;1;96m" : "\033[0;1;36m";
-	static char const* white = has256color ? "\033[0;1;97m" : "\033[0;1;37m";
-	static char const error[] = "\033[101;1;33m";
-
-	char const* code( reset );
-	switch ( color_ ) {
-		case Replxx::Color::BLACK:         code = black;         break;
-		case Replxx::Color::RED:           code = red;           break;
-		case Replxx::Color::GREEN:         code = green;         break;
-		case Replxx::Color::BROWN:         code = brown;         break;
-		case Replxx::Color::BLUE:          code = blue;          break;
-		case Replxx::Color::MAGENTA:       code = magenta;       break;
-		case Replxx::Color::CYAN:          code = cyan;          break;
-		case Replxx::Color::LIGHTGRAY:     code = lightgray;     break;
-		case Replxx::Color::GRAY:          code = gray;          break;
-		case Replxx::Color::BRIGHTRED:     code = brightred;     break;
-		case Replxx::Color::BRIGHTGREEN:   code = brightgreen;   break;
-		case Replxx::Color::YELLOW:        code = yellow;        break;
-		case Replxx::Color::BRIGHTBLUE:    code = brightblue;    break;
-		case Replxx::Color::BRIGHTMAGENTA: code = brightmagenta; break;
-		case Replxx::Color::BRIGHTCYAN:    code = brightcyan;    break;
-		case Replxx::Color::WHITE:         code = white;         break;
-		case Replxx::Color::ERROR:         code = error;         break;
-		case Replxx::Color::DEFAULT:       code = reset;         break;
+/*
+ * Make room for count_ more characters, as far as the maximum line length
+ * allows, and return how many of them fit.  Storage grows geometrically
+ * so appending is amortized O(1).
+ */
+int InputBuffer::reserve( int count_ ) {
+	if ( ( _maxLen > 0 ) && ( ( _len + count_ ) > _maxLen ) ) {
+		count_ = max( _maxLen - _len, 0 );
+	}
+	if ( ( _len + count_ ) > _buflen ) {
+		grow( max( _len + count_, 2 * _buflen ) );
 	}
-	return ( code );
+	return ( count_ );
 }
 
+void InputBuffer::grow( int capacity_ ) {
+	if ( capacity_ <= _buflen ) {
+		return;
+	}
+	input_buffer_t buf( new char32_t[capacity_ + 1] );
+	memcpy( buf.get(), _buf32.get(), sizeof ( char32_t ) * ( _len + 1 ) );
+	_buf32.swap( buf );
+	_buflen = capacity_;
+}
+
+/*
+ * Replace whole text, e.g. with a history entry,
+ * text over the maximum line length is dropped.
+ */
+void InputBuffer::set_text( char const* text_ ) {
+	// there are never fewer bytes than characters in UTF-8
+	int size( static_cast<int>( strlen( text_ ) ) );
+	_len = 0;
+	grow( size );
+	size_t count( 0 );
+	copyString8to32( _buf32.get(), size + 1, count, text_ );
+	_len = ( _maxLen > 0 ) ? min( static_cast<int>( count ), _maxLen ) : static_cast<int>( count );
+	_buf32[_len] = 0;
+	text_reset();
+}
+
+void InputBuffer::set_text( char32_t const* text_, int len_ ) {
+	_len = 0;
+	grow( len_ );
+	_len = ( _maxLen > 0 ) ? min( len_, _maxLen ) : len_;
+	memcpy( _buf32.get(), text_, sizeof ( char32_t ) * _len );
+	_buf32[_len] = 0;
+	text_reset();
+}
+
+/*
+ * Append code of given color to the display buffer.  Code not followed
+ * by any text is replaced and setting color already in effect is skipped,
+ * so runs of the same color are not interrupted.
+ */
 void InputBuffer::setColor( Replxx::Color color_ ) {
-	char const* code( ansi_color( color_ ) );
-	while ( *code ) {
-		_display.push_back( *code );
-		++ code;
+	if ( static_cast<int>( _display.size() ) == _colorCodeEnd ) {
+		_display.resize( _colorCodeStart );
+		_displayColor = _colorBeforeCode;
+		_colorCodeEnd = -1;
 	}
+	if ( color_ == _displayColor ) {
+		return;
+	}
+	_colorBeforeCode = _displayColor;
+	_colorCodeStart = static_cast<int>( _display.size() );
+	_replxx.palette().append( _display, color_ );
+	_colorCodeEnd = static_cast<int>( _display.size() );
+	_displayColor = color_;
+}
+
+/*
+ * Following functions must be called after each change of the buffer contents,
+ * they keep character widths, incremental highlighter colors, bracket structure
+ * and the range of the edit up to date.
+ */
+void InputBuffer::text_inserted( int pos_, int count_ ) {
+	_charWidths.insert( pos_, _buf32.get() + pos_, count_ );
+	note_edit( pos_, 0, count_ );
+}
+
+void InputBuffer::text_erased( int pos_, int count_ ) {
+	_charWidths.erase( pos_, count_ );
+	note_edit( pos_, count_, 0 );
+}
+
+void InputBuffer::text_replaced( int pos_, int count_ ) {
+	_charWidths.replace( pos_, _buf32.get() + pos_, count_ );
+	note_edit( pos_, count_, count_ );
+}
+
+void InputBuffer::text_reset( void ) {
+	int oldLen( _charWidths.size() );
+	_charWidths.reset( _buf32.get(), _len );
+	note_edit( 0, oldLen, _len );
+}
+
+/*
+ * Merge an edit with edits done since last incremental highlighting,
+ * so the highlighter is told about a single changed range.
+ */
+void InputBuffer::note_edit( int pos_, int removed_, int inserted_ ) {
+	if ( ( removed_ == 0 ) && ( inserted_ == 0 ) ) {
+		return;
+	}
+	_utf8Dirty = min( _utf8Dirty, pos_ );
+	_brackets.invalidate( pos_ );
+	if ( _replxx.has_incremental_highlighter() && ( pos_ <= static_cast<int>( _colors.size() ) ) ) {
+		int removed( min( removed_, static_cast<int>( _colors.size() ) - pos_ ) );
+		_colors.erase( _colors.begin() + pos_, _colors.begin() + pos_ + removed );
+		_colors.insert( _colors.begin() + pos_, inserted_, Replxx::Color::DEFAULT );
+	}
+	if ( _editPos == -1 ) {
+		_editPos = pos_;
+		_editRemoved = removed_;
+		_editInserted = inserted_;
+		return;
+	}
+	// end of both changed ranges in coordinates of text before this edit
+	int end( max( _editPos + _editInserted, pos_ + removed_ ) );
+	int start( min( _editPos, pos_ ) );
+	_editRemoved = end - _editInserted + _editRemoved - start;
+	_editInserted = end - removed_ + inserted_ - start;
+	_editPos = start;
+}
+
+/*
+ * Get view of first len_ characters of the input for callbacks.
+ *
+ * UTF-8 copy of the input is re-encoded only from the first character
+ * changed since previous call, so typing at the end of the line
+ * encodes just the new characters.
+ */
+Replxx::InputView InputBuffer::input_view( int len_ ) {
+	if ( _utf8Cut != -1 ) {
+		_utf8[_utf8Cut] = _utf8CutByte;
+		_utf8Cut = -1;
+	}
+	if ( _utf8Dirty < _utf8Chars ) {
+		_utf8.resize( utf8_offset( _utf8Dirty ) );
+		_utf8Chars = _utf8Dirty;
+	}
+	if ( _utf8Chars < _len ) {
+		int count( _len - _utf8Chars );
+		size_t used( _utf8.size() );
+		size_t len8( 4 * count + 1 );
+		size_t count8( 0 );
+		_utf8.resize( used + len8 );
+		copyString32to8( &_utf8[used], len8, &count8, _buf32.get() + _utf8Chars, count );
+		_utf8.resize( used + count8 );
+	}
+	_utf8Chars = _utf8Dirty = _len;
+	int size( static_cast<int>( _utf8.size() ) );
+	if ( len_ < _len ) {
+		size = utf8_offset( len_ );
+		_utf8Cut = size;
+		_utf8CutByte = _utf8[size];
+		_utf8[size] = 0;
+	}
+	return ( Replxx::InputView( _utf8.c_str(), size, _buf32.get(), len_ ) );
+}
+
+/*
+ * Byte offset of given character in _utf8, found by walking back from its end.
+ */
+int InputBuffer::utf8_offset( int pos_ ) {
+	if ( locale::is8BitEncoding ) {
+		return ( pos_ );
+	}
+	int offset( static_cast<int>( _utf8.size() ) );
+	for ( int i( _utf8Chars ); i > pos_; -- i ) {
+		do {
+			-- offset;
+		} while ( ( _utf8[offset] & 0xC0 ) == 0x80 );
+	}
+	return ( offset );
 }
 
 void InputBuffer::highlight( int highlightIdx, bool error_ ) {
-	Replxx::colors_t colors( _len, Replxx::Color::DEFAULT );
-	Utf32String unicodeCopy( _buf32.get(), _len );
-	Utf8String parseItem( unicodeCopy );
-	_replxx.call_highlighter( parseItem.get(), colors );
+	Replxx::colors_t& colors( _displayColors );
+	if ( _replxx.has_incremental_highlighter() ) {
+		if ( static_cast<int>( _colors.size() ) != _len ) {
+			// callback was installed during this edit session
+			_editPos = 0;
+			_editRemoved = static_cast<int>( _colors.size() );
+			_editInserted = _len;
+			_colors.assign( _len, Replxx::Color::DEFAULT );
+		}
+		if ( _editPos != -1 ) {
+			_replxx.call_incremental_highlighter( input_view( _len ), _editPos, _editRemoved, _editInserted, _colors );
+			_colors.resize( _len, Replxx::Color::DEFAULT );
+			_editPos = -1;
+		}
+		colors = _colors;
+	} else {
+		colors.assign( _len, Replxx::Color::DEFAULT );
+		_replxx.call_highlighter( input_view( _len ), colors );
+	}
 	if ( highlightIdx != -1 ) {
 		colors[highlightIdx] = error_ ? Replxx::Color::ERROR : Replxx::Color::BRIGHTRED;
 	}
 	_display.clear();
+	_displayColor = Replxx::Color::DEFAULT;
+	_colorCodeEnd = -1;
 	Replxx::Color c( Replxx::Color::DEFAULT );
 	for ( int i( 0 ); i < _len; ++ i ) {
 		if ( colors[i] != c ) {
@@ -124,7 +288,9 @@ void InputBuffer::highlight( int highlightIdx, bool error_ ) {
 		}
 		_display.push_back( _buf32[i] );
 	}
-	setColor( Replxx::Color::DEFAULT );
+	if ( c != Replxx::Color::DEFAULT ) {
+		setColor( Replxx::Color::DEFAULT );
+	}
 }
 
 int InputBuffer::handle_hints( PromptBase& pi, HINT_ACTION hintAction_ ) {
@@ -135,14 +301,22 @@ int InputBuffer::handle_hints( PromptBase& pi, HINT_ACTION hintAction_ ) {
 			_hintSelection = -1;
 		}
 		Replxx::Color c( Replxx::Color::GRAY );
-		Utf32String unicodeCopy( _buf32.get(), _pos );
-		Utf8String parseItem(unicodeCopy);
+		Replxx::InputView input( input_view( _pos ) );
 		int startIndex( start_index() );
-		Replxx::ReplxxImpl::hints_t hints( _replxx.call_hinter( parseItem.get(), startIndex, c ) );
-		int hintCount( hints.size() );
+		if ( _replxx.has_async_hinter() ) {
+			// show whatever was posted so far, repaint is triggered when hints arrive
+			_replxx.request_hints( input, startIndex );
+		}
+		Replxx::Collector const& hints(
+			_replxx.has_async_hinter()
+				? _replxx.posted_hints( c )
+				: _replxx.call_hinter( input, startIndex, c )
+		);
+		// only hints which are displayed get converted to UTF-32
+		int hintCount( hints.count() );
 		if ( hintCount == 1 ) {
 			setColor( c );
-			_hint = hints.front();
+			_hint.assign( hints.get( 0 ) );
 			len = _hint.length();
 			for ( int i( 0 ); i < len; ++ i ) {
 				_display.push_back( _hint[i] );
@@ -161,13 +335,14 @@ int InputBuffer::handle_hints( PromptBase& pi, HINT_ACTION hintAction_ ) {
 			}
 			setColor( c );
 			if ( _hintSelection != -1 ) {
-				_hint = hints[_hintSelection];
+				_hint.assign( hints.get( _hintSelection ) );
 				len = min<int>( _hint.length(), maxCol - startCol - _len );
 				for ( int i( 0 ); i < len; ++ i ) {
 					_display.push_back( _hint[i] );
 				}
 			}
 			setColor( Replxx::Color::DEFAULT );
+			Utf32String h;
 			for ( int hintRow( 0 ); hintRow < min( hintCount, _replxx.max_hint_rows() ); ++ hintRow ) {
 #ifdef _WIN32
 				_display.push_back( '\r' );
@@ -187,13 +362,15 @@ int InputBuffer::handle_hints( PromptBase& pi, HINT_ACTION hintAction_ ) {
 				} else if ( hintNo > hintCount ) {
 					-- hintNo;
 				}
-				Utf32String const& h( hints[hintNo % hintCount] );
+				h.assign( hints.get( hintNo % hintCount ) );
 				for ( size_t i( 0 ); ( i < h.length() ) && ( col < maxCol ); ++ i, ++ col ) {
 					_display.push_back( h[i] );
 				}
 				setColor( Replxx::Color::DEFAULT );
 			}
 		}
+	} else if ( ( hintAction_ == HINT_ACTION::REGENERATE ) && _replxx.has_async_hinter() ) {
+		_replxx.cancel_hints();
 	}
 	return ( len );
 }
@@ -205,63 +382,29 @@ int InputBuffer::handle_hints( PromptBase& pi, HINT_ACTION hintAction_ ) {
  * screen position
  */
 void InputBuffer::refreshLine(PromptBase& pi, HINT_ACTION hintAction_) {
-	// check for a matching brace/bracket/paren, remember its position if found
-	int highlightIdx = -1;
-	bool indicateError = false;
-	if (_pos < _len) {
-		/* this scans for a brace matching _buf32[_pos] to highlight */
-		unsigned char part1, part2;
-		int scanDirection = 0;
-		if (strchr("}])", _buf32[_pos])) {
-			scanDirection = -1; /* backwards */
-			if (_buf32[_pos] == '}') {
-				part1 = '}'; part2 = '{';
-			} else if (_buf32[_pos] == ']') {
-				part1 = ']'; part2 = '[';
-			} else {
-				part1 = ')'; part2 = '(';
-			}
-		} else if (strchr("{[(", _buf32[_pos])) {
-			scanDirection = 1; /* forwards */
-			if (_buf32[_pos] == '{') {
-				//part1 = '{'; part2 = '}';
-				part1 = '}'; part2 = '{';
-			} else if (_buf32[_pos] == '[') {
-				//part1 = '['; part2 = ']';
-				part1 = ']'; part2 = '[';
-			} else {
-				//part1 = '('; part2 = ')';
-				part1 = ')'; part2 = '(';
-			}
+	bool delayHints( false );
+	if ( hintAction_ == HINT_ACTION::REGENERATE ) {
+		if ( input_pending() ) {
+			// more keys are waiting, repaint once after all of them are handled
+			_refreshPending = true;
+			return;
 		}
-
-		if (scanDirection) {
-			int unmatched = scanDirection;
-			int unmatchedOther = 0;
-			for (int i = _pos + scanDirection; i >= 0 && i < _len; i += scanDirection) {
-				/* TODO: the right thing when inside a string */
-				if (strchr("}])", _buf32[i])) {
-					if (_buf32[i] == part1) {
-						--unmatched;
-					} else {
-						--unmatchedOther;
-					}
-				} else if (strchr("{[(", _buf32[i])) {
-					if (_buf32[i] == part2) {
-						++unmatched;
-					} else {
-						++unmatchedOther;
-					}
-				}
-
-				if (unmatched == 0) {
-					highlightIdx = i;
-					indicateError = (unmatchedOther != 0);
-					break;
-				}
+		delayHints = ( _replxx.hint_delay() > 0 ) && _replxx.has_hinter();
+		if ( delayHints ) {
+			_hintSelection = -1;
+			if ( _replxx.has_async_hinter() ) {
+				_replxx.cancel_hints();
 			}
+			hintAction_ = HINT_ACTION::SKIP;
 		}
 	}
+	_refreshPending = false;
+	_hintsPending = delayHints;
+
+	// check for a matching brace/bracket/paren, remember its position if found
+	_brackets.set_quotes( _replxx.quote_characters() );
+	bool indicateError( false );
+	int highlightIdx( _brackets.match( _buf32.get(), _len, _pos, &indicateError ) );
 
 	highlight( highlightIdx, indicateError );
 	int hintLen( handle_hints( pi, hintAction_ ) );
@@ -269,7 +412,7 @@ void InputBuffer::refreshLine(PromptBase& pi, HINT_ACTION hintAction_) {
 	int xEndOfInput( 0 ), yEndOfInput( 0 );
 	calculateScreenPosition(
 		pi.promptIndentation, 0, pi.promptScreenColumns,
-		calculateColumnPosition( _buf32.get(), _len ) + hintLen,
+		_charWidths.column( _len ) + hintLen,
 		xEndOfInput, yEndOfInput
 	);
 	yEndOfInput += count( _display.begin(), _display.end(), '\n' );
@@ -278,12 +421,15 @@ void InputBuffer::refreshLine(PromptBase& pi, HINT_ACTION hintAction_) {
 	int xCursorPos( 0 ), yCursorPos( 0 );
 	calculateScreenPosition(
 		pi.promptIndentation, 0, pi.promptScreenColumns,
-		calculateColumnPosition(_buf32.get(), _pos),
+		_charWidths.column( _pos ),
 		xCursorPos,
 		yCursorPos
 	);
 
 #ifdef _WIN32
+	OutputBuffer& out( _replxx.output() );
+	// console API calls below require everything pending to be on the screen already
+	if ( out.flush() == -1 ) return;
 	// position at the end of the prompt, clear to end of previous input
 	CONSOLE_SCREEN_BUFFER_INFO inf;
 	GetConsoleScreenBufferInfo(console_out, &inf);
@@ -295,10 +441,11 @@ void InputBuffer::refreshLine(PromptBase& pi, HINT_ACTION hintAction_) {
 
 	// display the input line
 	if ( !_replxx.no_color() ) {
-		if (write32(1, _display.data(), _display.size()) == -1) return;
+		out.write32( _display.data(), static_cast<int>( _display.size() ) );
 	} else {
-		if (write32(1, _buf32.get(), _len) == -1) return;
+		out.write32( _buf32.get(), _len );
 	}
+	if ( out.flush() == -1 ) return;
 
 	// position the cursor
 	GetConsoleScreenBufferInfo(console_out, &inf);
@@ -306,56 +453,256 @@ void InputBuffer::refreshLine(PromptBase& pi, HINT_ACTION hintAction_) {
 	inf.dwCursorPosition.Y -= ( yEndOfInput - yCursorPos );
 	SetConsoleCursorPosition(console_out, inf.dwCursorPosition);
 #else	// _WIN32
-	char seq[64];
-	int cursorRowMovement = pi.promptCursorRowOffset - pi.promptExtraLines;
-	if (cursorRowMovement > 0) {	// move the cursor up as required
-		snprintf(seq, sizeof seq, "\x1b[%dA", cursorRowMovement);
-		if (write(1, seq, strlen(seq)) == -1) return;
+	if ( !_replxx.no_color() ) {
+		paint( pi, _display.data(), static_cast<int>( _display.size() ), xCursorPos, yCursorPos );
+	} else {
+		paint( pi, _buf32.get(), _len, xCursorPos, yCursorPos );
 	}
-	// position at the end of the prompt, clear to end of screen
-	snprintf(
-		seq, sizeof seq, "\x1b[%dG\x1b[%c",
-		pi.promptIndentation + 1, /* 1-based on VT100 */
-		'J'
+#endif
+
+	pi.promptCursorRowOffset =
+			pi.promptExtraLines + yCursorPos;	// remember row for next pass
+}
+
+/**
+ * Erase displayed input leaving the prompt in place and the cursor just past it.
+ *
+ * The buffer itself is not changed.
+ *
+ * @param pi PromptBase struct holding information about the prompt and our
+ * screen position
+ */
+void InputBuffer::erase_input( PromptBase& pi ) {
+#ifdef _WIN32
+	if ( _replxx.output().flush() == -1 ) return;
+	CONSOLE_SCREEN_BUFFER_INFO inf;
+	GetConsoleScreenBufferInfo(console_out, &inf);
+	inf.dwCursorPosition.X = pi.promptIndentation;	// 0-based on Win32
+	inf.dwCursorPosition.Y -= pi.promptCursorRowOffset - pi.promptExtraLines;
+	SetConsoleCursorPosition(console_out, inf.dwCursorPosition);
+	clear_screen( CLEAR_SCREEN::TO_END );
+	pi.promptPreviousInputLen = 0;
+#else
+	paint( pi, _buf32.get(), 0, pi.promptIndentation, 0 );
+#endif
+	pi.promptCursorRowOffset = pi.promptExtraLines;
+}
+
+#ifndef _WIN32
+
+namespace {
+
+/*
+ * Advance screen position over single displayed character,
+ * follows calculateScreenPosition() rules for line wrapping.
+ */
+inline void advance_position( char32_t c, int columns_, int& x_, int& y_ ) {
+	if ( c == '\n' ) {
+		x_ = 0;
+		++ y_;
+		return;
+	}
+	int w( mk_wcwidth( c ) );
+	x_ += ( w < 0 ) ? 1 : w;
+	if ( x_ >= columns_ ) {
+		x_ -= columns_;
+		++ y_;
+	}
+}
+
+inline int cursor_sequence( char* seq_, int size_, int count_, char code_ ) {
+	return ( snprintf( seq_, static_cast<size_t>( size_ ), "\x1b[%d%c", count_, code_ ) );
+}
+
+}
+
+/**
+ * Bring the terminal from what previous refresh painted to the new frame.
+ *
+ * Only the part of the frame starting at the first character that differs
+ * from the retained screen model is written, if nothing differs only the cursor
+ * is moved.  Without a valid model whole input line is repainted.
+ * All of it, together with anything already pending in the output buffer,
+ * is sent to the terminal with a single write.
+ *
+ * @param pi       PromptBase struct holding information about the prompt and our
+ * screen position
+ * @param frame_   characters and SGR escape sequences to display after the prompt
+ * @param len_     length of the frame
+ * @param xCursor_ desired cursor column
+ * @param yCursor_ desired cursor row (relative to the end of the prompt)
+ */
+void InputBuffer::paint( PromptBase& pi, char32_t const* frame_, int len_, int xCursor_, int yCursor_ ) {
+	int columns( pi.promptScreenColumns );
+	bool valid(
+		_screen.valid
+		&& ( _screen.indentation == pi.promptIndentation )
+		&& ( _screen.columns == columns )
 	);
-	if (write(1, seq, strlen(seq)) == -1) return;
+	int oldLen( valid ? static_cast<int>( _screen.frame.size() ) : 0 );
+	int common( 0 );
+	if ( valid ) {
+		int limit( min( len_, oldLen ) );
+		while ( ( common < limit ) && ( frame_[common] == _screen.frame[common] ) ) {
+			++ common;
+		}
+	}
 
-	if ( !_replxx.no_color() ) {
-		if (write32(1, _display.data(), _display.size()) == -1) return;
-	} else {	// highlightIdx the matching brace/bracket/parenthesis
-		if (write32(1, _buf32.get(), _len) == -1) return;
+	// screen position of the first changed character, and the escape sequence
+	// that sets color active at that position, are known from previous refresh
+	Screen::positions_t& positions( _screen.positions );
+	if ( ! valid ) {
+		Screen::Position start = { pi.promptIndentation, 0, -1, 0, 0 };
+		positions.assign( 1, start );
+	}
+	// difference inside of an escape sequence
+	common = positions[common].start;
+	// combining characters are drawn over the preceding character,
+	// so that character has to be repainted too
+	if (
+		( common > 0 )
+		&& (
+			( ( common < len_ ) && ( frame_[common] != '\033' ) && ( mk_wcwidth( frame_[common] ) == 0 ) )
+			|| ( ( common < oldLen ) && ( _screen.frame[common] != '\033' ) && ( mk_wcwidth( _screen.frame[common] ) == 0 ) )
+		)
+	) {
+		common = positions[common].base;
+	}
+	int x( positions[common].x );
+	int y( positions[common].y );
+	int sgr( positions[common].sgr );
+
+	// extend the model over the rest of the new frame
+	Screen::Position position( positions[common] );
+	bool visibleTail( false );
+	positions.resize( len_ + 1 );
+	int i( common );
+	while ( i < len_ ) {
+		position.start = i;
+		if ( frame_[i] == '\033' ) {
+			int e( i );
+			while ( ( e < len_ ) && ( frame_[e] != 'm' ) ) {
+				++ e;
+			}
+			for ( int k( i ); k <= min( e, len_ - 1 ); ++ k ) {
+				positions[k] = position;
+			}
+			if ( e >= len_ ) {
+				break;
+			}
+			position.sgr = i;
+			i = e + 1;
+			continue;
+		}
+		positions[i] = position;
+		if ( mk_wcwidth( frame_[i] ) != 0 ) {
+			position.base = i;
+		}
+		visibleTail = true;
+		advance_position( frame_[i], columns, position.x, position.y );
+		++ i;
+	}
+	if ( i >= len_ ) {
+		position.start = len_;
 	}
+	positions[len_] = position;
 
-	// we have to generate our own newline on line wrap
-	if (xEndOfInput == 0 && yEndOfInput > 0)
-		if (write(1, "\n", 1) == -1) return;
+	OutputBuffer& out( _replxx.output() );
+	char seq[64];
+	int seqLen( 0 );
+	int cursorX( valid ? _screen.cursorX : -1 );
+	int cursorY( pi.promptCursorRowOffset - pi.promptExtraLines );
+	int endX( position.x );
+	int endY( position.y );
+	if ( ! valid || ( common < len_ ) || ( common < oldLen ) ) {
+		// move to the first changed character
+		if ( y != cursorY ) {
+			seqLen = cursor_sequence( seq, sizeof seq, y > cursorY ? y - cursorY : cursorY - y, y > cursorY ? 'B' : 'A' );
+			out.write8( seq, seqLen );
+		}
+		if ( x != cursorX ) {
+			seqLen = cursor_sequence( seq, sizeof seq, x + 1, 'G' ); // 1-based on VT100
+			out.write8( seq, seqLen );
+		}
+		// clear what is left from the previous frame
+		if ( ! valid || ( _screen.endX != x ) || ( _screen.endY != y ) ) {
+			out.write8( "\x1b[J", 3 );
+		}
+		if ( common < len_ ) {
+			if ( ( sgr != -1 ) && ( frame_[common] != '\033' ) ) {
+				int sgrEnd( sgr );
+				while ( frame_[sgrEnd] != 'm' ) {
+					++ sgrEnd;
+				}
+				out.write32( frame_ + sgr, sgrEnd + 1 - sgr );
+			}
+			out.write32( frame_ + common, len_ - common );
+		}
+		// we have to generate our own newline on line wrap
+		if ( visibleTail && ( endX == 0 ) && ( endY > 0 ) && ( frame_[len_ - 1] != '\n' ) ) {
+			out.write8( "\n", 1 );
+		}
+		cursorX = endX;
+		cursorY = endY;
+	} else {
+		endX = _screen.endX;
+		endY = _screen.endY;
+	}
 
 	// position the cursor
-	cursorRowMovement = yEndOfInput - yCursorPos;
-	if (cursorRowMovement > 0) {	// move the cursor up as required
-		snprintf(seq, sizeof seq, "\x1b[%dA", cursorRowMovement);
-		if (write(1, seq, strlen(seq)) == -1) return;
+	if ( yCursor_ != cursorY ) {
+		seqLen = cursor_sequence( seq, sizeof seq, yCursor_ > cursorY ? yCursor_ - cursorY : cursorY - yCursor_, yCursor_ > cursorY ? 'B' : 'A' );
+		out.write8( seq, seqLen );
 	}
-	// position the cursor within the line
-	snprintf(seq, sizeof seq, "\x1b[%dG", xCursorPos + 1);	// 1-based on VT100
-	if (write(1, seq, strlen(seq)) == -1) return;
+	if ( xCursor_ != cursorX ) {
+		seqLen = cursor_sequence( seq, sizeof seq, xCursor_ + 1, 'G' ); // 1-based on VT100
+		out.write8( seq, seqLen );
+	}
+	if ( out.flush() == -1 ) {
+		_screen.valid = false;
+		return;
+	}
+
+	_screen.frame.assign( frame_, frame_ + len_ );
+	_screen.endX = endX;
+	_screen.endY = endY;
+	_screen.cursorX = xCursor_;
+	_screen.indentation = pi.promptIndentation;
+	_screen.columns = columns;
+	_screen.valid = true;
+}
+
 #endif
 
-	pi.promptCursorRowOffset =
-			pi.promptExtraLines + yCursorPos;	// remember row for next pass
+namespace {
+
+void write_padding( OutputBuffer& out_, int count_ ) {
+	static char const spaces[] = "                                ";
+	int const chunk( static_cast<int>( sizeof ( spaces ) ) - 1 );
+	for ( ; count_ > 0; count_ -= chunk ) {
+		out_.write8( spaces, min( count_, chunk ) );
+	}
+}
+
+// break characters and special prefixes are 7-bit ASCII,
+// strchr() alone would match any character by its low byte
+bool is_one_of( char const* set_, char32_t c_ ) {
+	return ( ( c_ < 128 ) && ( strchr( set_, static_cast<char>( c_ ) ) != nullptr ) );
+}
+
 }
 
 int InputBuffer::start_index() {
 	int startIndex = _pos;
 	while (--startIndex >= 0) {
-		if ( strchr(_replxx.break_chars(), _buf32[startIndex]) ) {
+		if ( is_one_of( _replxx.break_chars(), _buf32[startIndex] ) ) {
 			break;
 		}
 	}
-	if ( ( startIndex < 0 ) || ! strchr( _replxx.special_prefixes(), _buf32[startIndex] ) ) {
+	if ( ( startIndex < 0 ) || ! is_one_of( _replxx.special_prefixes(), _buf32[startIndex] ) ) {
 		++ startIndex;
 	}
-	while ( ( startIndex > 0 ) && ( strchr( _replxx.special_prefixes(), _buf32[startIndex - 1] ) != nullptr ) ) {
+	while ( ( startIndex > 0 ) && is_one_of( _replxx.special_prefixes(), _buf32[startIndex - 1] ) ) {
 		-- startIndex;
 	}
 	return ( startIndex );
@@ -376,69 +723,93 @@ int InputBuffer::completeLine(PromptBase& pi) {
 
 	// completionCallback() expects a parsable entity, so find the previous break
 	// character and
-	// extract a copy to parse.	we also handle the case where tab is hit while
-	// not at end-of-line.
+	// pass a view of input up to the cursor.	we also handle the case where tab
+	// is hit while not at end-of-line.
 	int startIndex( start_index() );
 	int itemLength( _pos - startIndex );
 
-	Utf32String unicodeCopy(_buf32.get(), _pos);
-	Utf8String parseItem(unicodeCopy);
+	Replxx::InputView input( input_view( _pos ) );
 	// get a list of completions
-	Replxx::ReplxxImpl::completions_t completions( _replxx.call_completer( parseItem.get(), startIndex ) );
+	if ( _replxx.has_async_completer() ) {
+		_replxx.request_completions( input, startIndex );
+		while ( ! _replxx.posted_completions() ) {
+			c = cleanupCtrl( read_char( true ) );
+			if ( ( c == ASYNC_RESULT ) || ( c == ctrlChar('I') ) || ( c == static_cast<char32_t>( -1 ) ) ) {
+				continue;
+			}
+			// user did not wait for completions, pass the key to the main loop
+			_replxx.cancel_completions();
+			return c;
+		}
+	} else {
+		_replxx.call_completer( input, startIndex );
+	}
+	Replxx::Collector const& completions( _replxx.completions() );
 
 	// if no completions, we are done
-	if (completions.size() == 0) {
+	if ( completions.count() == 0 ) {
 		beep();
 		return 0;
 	}
 
-	// at least one completion
+	// at least one completion, the common prefix is found on UTF-8 bytes
+	// and only the completion actually inserted is converted to UTF-32
 	int longestCommonPrefix = 0;
+	int longestCommonPrefixBytes = 0;
 	int displayLength = 0;
-	int completionsCount( completions.size() );
+	int completionsCount( completions.count() );
 	int selectedCompletion( 0 );
-	if ( _hintSelection != -1 ) {
+	if ( ( _hintSelection != -1 ) && ( _hintSelection < completionsCount ) ) {
 		selectedCompletion = _hintSelection;
 		completionsCount = 1;
 	}
 	if ( completionsCount == 1) {
-		longestCommonPrefix = static_cast<int>(completions[selectedCompletion].length());
+		longestCommonPrefixBytes = completions.size( selectedCompletion );
 	} else {
-		bool keepGoing = true;
-		while (keepGoing) {
-			for (int j = 0; j < completionsCount - 1; ++j) {
-				char32_t c1 = completions[j][longestCommonPrefix];
-				char32_t c2 = completions[j + 1][longestCommonPrefix];
-				if ((0 == c1) || (0 == c2) || (c1 != c2)) {
-					keepGoing = false;
-					break;
-				}
-			}
-			if (keepGoing) {
-				++longestCommonPrefix;
+		// common prefix of all completions is the common prefix of the
+		// smallest and the largest of them, UTF-8 byte order is code point order
+		int smallest( 0 );
+		int largest( 0 );
+		for ( int j( 1 ); j < completionsCount; ++ j ) {
+			char const* completion( completions.get( j ) );
+			if ( strcmp( completion, completions.get( smallest ) ) < 0 ) {
+				smallest = j;
+			} else if ( strcmp( completion, completions.get( largest ) ) > 0 ) {
+				largest = j;
 			}
 		}
+		char const* first( completions.get( smallest ) );
+		char const* last( completions.get( largest ) );
+		int size( min( completions.size( smallest ), completions.size( largest ) ) );
+		while ( ( longestCommonPrefixBytes < size ) && ( first[longestCommonPrefixBytes] == last[longestCommonPrefixBytes] ) ) {
+			++ longestCommonPrefixBytes;
+		}
+		longestCommonPrefixBytes = char_boundary8( first, longestCommonPrefixBytes );
 	}
+	longestCommonPrefix = strlen8( completions.get( selectedCompletion ), longestCommonPrefixBytes );
 	if ( _replxx.beep_on_ambiguous_completion() && ( completionsCount != 1 ) ) {	// beep if ambiguous
 		beep();
 	}
 
 	// if we can extend the item, extend it and return to main loop
 	if ( ( longestCommonPrefix > itemLength ) || ( completionsCount == 1 ) ) {
-		displayLength = _len + longestCommonPrefix - itemLength;
-		if (displayLength > _buflen) {
-			longestCommonPrefix -= displayLength - _buflen; // don't overflow buffer
-			displayLength = _buflen;                        // truncate the insertion
-			beep();                                         // and make a noise
+		int extra( reserve( longestCommonPrefix - itemLength ) );
+		if ( extra < ( longestCommonPrefix - itemLength ) ) {
+			longestCommonPrefix = itemLength + extra; // line would be too long
+			beep();                                   // truncate the insertion and make a noise
 		}
+		displayLength = _len + longestCommonPrefix - itemLength;
+		Utf32String completion( completions.get( selectedCompletion ) );
 		Utf32String displayText(displayLength + 1);
 		memcpy(displayText.get(), _buf32.get(), sizeof(char32_t) * startIndex);
-		memcpy(&displayText[startIndex], &completions[selectedCompletion][0],
+		memcpy(&displayText[startIndex], completion.get(),
 					 sizeof(char32_t) * longestCommonPrefix);
 		int tailIndex = startIndex + longestCommonPrefix;
 		memcpy(&displayText[tailIndex], &_buf32[_pos],
 					 sizeof(char32_t) * (displayLength - tailIndex + 1));
 		copyString32(_buf32.get(), displayText.get(), displayLength);
+		text_erased( startIndex, itemLength );
+		text_inserted( startIndex, longestCommonPrefix );
 		_prefix = _pos = startIndex + longestCommonPrefix;
 		_len = displayLength;
 		refreshLine(pi);
@@ -459,17 +830,20 @@ int InputBuffer::completeLine(PromptBase& pi) {
 	}
 
 	// we got a second tab, maybe show list of possible completions
+	OutputBuffer& out( _replxx.output() );
 	bool showCompletions = true;
 	bool onNewLine = false;
-	if (static_cast<int>( completions.size() ) > _replxx.completion_count_cutoff()) {
+	if (completions.count() > _replxx.completion_count_cutoff()) {
 		int savePos =
 				_pos;	// move cursor to EOL to avoid overwriting the command line
 		_pos = _len;
-		refreshLine(pi);
+		refreshLine( pi, HINT_ACTION::SKIP );
 		_pos = savePos;
-		printf("\nDisplay all %u possibilities? (y or n)",
-					 static_cast<unsigned int>(completions.size()));
-		fflush(stdout);
+		char question[64];
+		snprintf(question, sizeof question, "\nDisplay all %u possibilities? (y or n)",
+					 static_cast<unsigned int>(completions.count()));
+		out.write8(question);
+		if (out.flush() == -1) return -1;
 		onNewLine = true;
 		while (c != 'y' && c != 'Y' && c != 'n' && c != 'N' && c != ctrlChar('C')) {
 			do {
@@ -484,7 +858,7 @@ int InputBuffer::completeLine(PromptBase& pi) {
 				break;
 			case ctrlChar('C'):
 				showCompletions = false;
-				if (write(1, "^C", 2) == -1) return -1;	// Display the ^C we got
+				out.write8("^C", 2);	// Display the ^C we got
 				c = 0;
 				break;
 		}
@@ -493,11 +867,14 @@ int InputBuffer::completeLine(PromptBase& pi) {
 	// if showing the list, do it the way readline does it
 	bool stopList = false;
 	if (showCompletions) {
+		// lengths are measured once for the layout, rows are formatted
+		// only when they are shown, one page at a time
 		int longestCompletion = 0;
-		for (size_t j = 0; j < completions.size(); ++j) {
-			itemLength = static_cast<int>(completions[j].length());
-			if (itemLength > longestCompletion) {
-				longestCompletion = itemLength;
+		_completionLengths.resize( completions.count() );
+		for ( int j( 0 ); j < completions.count(); ++ j ) {
+			_completionLengths[j] = strlen8( completions.get( j ), completions.size( j ) );
+			if ( _completionLengths[j] > longestCompletion ) {
+				longestCompletion = _completionLengths[j];
 			}
 		}
 		longestCompletion += 2;
@@ -515,11 +892,11 @@ int InputBuffer::completeLine(PromptBase& pi) {
 		}
 		size_t pauseRow = getScreenRows() - 1;
 		size_t rowCount =
-				(completions.size() + columnCount - 1) / columnCount;
+				(completions.count() + columnCount - 1) / columnCount;
 		for (size_t row = 0; row < rowCount; ++row) {
 			if (row == pauseRow) {
-				printf("\n--More--");
-				fflush(stdout);
+				out.write8("\n--More--");
+				if (out.flush() == -1) return -1;
 				c = 0;
 				bool doBeep = false;
 				while (c != ' ' && c != '\r' && c != '\n' && c != 'y' && c != 'Y' &&
@@ -538,99 +915,167 @@ int InputBuffer::completeLine(PromptBase& pi) {
 					case ' ':
 					case 'y':
 					case 'Y':
-						printf("\r				\r");
+						out.write8("\r				\r");
 						pauseRow += getScreenRows() - 1;
 						break;
 					case '\r':
 					case '\n':
-						printf("\r				\r");
+						out.write8("\r				\r");
 						++pauseRow;
 						break;
 					case 'n':
 					case 'N':
 					case 'q':
 					case 'Q':
-						printf("\r				\r");
+						out.write8("\r				\r");
 						stopList = true;
 						break;
 					case ctrlChar('C'):
-						if (write(1, "^C", 2) == -1) return -1;	// Display the ^C we got
+						out.write8("^C", 2);	// Display the ^C we got
 						stopList = true;
 						break;
 				}
 			} else {
-				printf("\n");
+				out.write8("\n", 1);
 			}
 			if (stopList) {
 				break;
 			}
 			for (int column = 0; column < columnCount; ++column) {
 				size_t index = (column * rowCount) + row;
-				if (index < completions.size()) {
-					itemLength = static_cast<int>(completions[index].length());
-					fflush(stdout);
-
-					static Utf32String const col( ansi_color( Replxx::Color::BRIGHTMAGENTA ) );
-					if ( !_replxx.no_color() && ( write32( 1, col.get(), col.length() ) == -1 ) )
-						return -1;
-					if (write32(1, completions[index].get(), longestCommonPrefix) == -1)
-						return -1;
-					static Utf32String const res( ansi_color( Replxx::Color::DEFAULT ) );
-					if ( !_replxx.no_color() && ( write32( 1, res.get(), res.length() ) == -1 ) )
-						return -1;
-
-					if (write32(1, completions[index].get() + longestCommonPrefix, itemLength - longestCommonPrefix) == -1)
-						return -1;
-
-					if (((column + 1) * rowCount) + row < completions.size()) {
-						for (int k = itemLength; k < longestCompletion; ++k) {
-							printf(" ");
-						}
+				if ( index < static_cast<size_t>( completions.count() ) ) {
+					int itemSize( completions.size( index ) );
+					itemLength = _completionLengths[index];
+
+					if ( !_replxx.no_color() ) {
+						_replxx.palette().write( out, Replxx::Color::BRIGHTMAGENTA );
+					}
+					out.write8( completions.get( index ), longestCommonPrefixBytes );
+					if ( !_replxx.no_color() ) {
+						_replxx.palette().write( out, Replxx::Color::DEFAULT );
+					}
+
+					out.write8( completions.get( index ) + longestCommonPrefixBytes, itemSize - longestCommonPrefixBytes );
+
+					if (((column + 1) * rowCount) + row < static_cast<size_t>( completions.count() )) {
+						write_padding( out, longestCompletion - itemLength );
 					}
 				}
 			}
 		}
-		fflush(stdout);
 	}
 
-	// display the prompt on a new line, then redisplay the input buffer
+	// display the prompt on a new line, then redisplay the input buffer,
+	// the list tail, the prompt and the input line go out in one write
 	if (!stopList || c == ctrlChar('C')) {
-		if (write(1, "\n", 1) == -1) return 0;
+		out.write8("\n", 1);
 	}
-	if (!pi.write()) return 0;
+	pi.write(out);
 #ifndef _WIN32
 	// we have to generate our own newline on line wrap on Linux
 	if (pi.promptIndentation == 0 && pi.promptExtraLines > 0)
-		if (write(1, "\n", 1) == -1) return 0;
+		out.write8("\n", 1);
 #endif
 	pi.promptCursorRowOffset = pi.promptExtraLines;
+	invalidate_screen();
 	refreshLine(pi);
 	return 0;
 }
 
+#ifndef _WIN32
+/**
+ * Insert text delivered between bracketed paste markers.
+ *
+ * Whole text is read up to the end of paste marker and inserted at the cursor
+ * position, then the line is refreshed once.	Newlines and tabs are converted
+ * to spaces, other control characters are dropped.
+ *
+ * @param pi	 PromptBase struct holding information about the prompt and our
+ * screen position
+ */
+void InputBuffer::paste(PromptBase& pi) {
+	static char32_t const pasteEnd[] = { '\x1b', '[', '2', '0', '1', '~' };
+	static int const pasteEndLen( static_cast<int>( sizeof ( pasteEnd ) / sizeof ( pasteEnd[0] ) ) );
+	// collect whole pasted text first, it is inserted with a single move of the tail
+	std::vector<char32_t> text;
+	int matched( 0 );
+	char32_t prev( 0 );
+	read_ahead( true );
+	while ( true ) {
+		char32_t c( readUnicodeCharacter() );
+		if ( c == 0 ) {
+			break;
+		}
+		if ( c == pasteEnd[matched] ) {
+			++ matched;
+			if ( matched == pasteEndLen ) {
+				break;
+			}
+			continue;
+		}
+		// a partial end marker is a part of the pasted text, the ESC itself is dropped
+		for ( int i( 1 ); i < matched; ++ i ) {
+			text.push_back( pasteEnd[i] );
+		}
+		if ( matched > 0 ) {
+			prev = pasteEnd[matched - 1];
+		}
+		matched = ( c == pasteEnd[0] ) ? 1 : 0;
+		if ( matched > 0 ) {
+			continue;
+		}
+		if ( ( c == '\n' ) && ( prev == '\r' ) ) {
+			prev = c;
+			continue;
+		}
+		prev = c;
+		if ( ( c == '\r' ) || ( c == '\n' ) || ( c == '\t' ) ) {
+			c = ' ';
+		} else if ( isControlChar( c ) ) {
+			continue;
+		}
+		text.push_back( c );
+	}
+	read_ahead( false );
+	int count( reserve( static_cast<int>( text.size() ) ) );
+	memmove( _buf32.get() + _pos + count, _buf32.get() + _pos, sizeof ( char32_t ) * ( _len - _pos ) );
+	if ( count > 0 ) {
+		memcpy( _buf32.get() + _pos, text.data(), sizeof ( char32_t ) * count );
+	}
+	text_inserted( _pos, count );
+	_len += count;
+	_pos += count;
+	_buf32[_len] = 0;
+	refreshLine( pi );
+	if ( count < static_cast<int>( text.size() ) ) {
+		beep();
+	}
+}
+#endif
+
 int InputBuffer::getInputLine(PromptBase& pi) {
 	// The latest history entry is always our current buffer
 	if (_len > 0) {
-		size_t bufferSize = sizeof(char32_t) * _len + 1;
-		unique_ptr<char[]> tempBuffer(new char[bufferSize]);
-		copyString32to8(tempBuffer.get(), bufferSize, _buf32.get());
-		_replxx.history_add(tempBuffer.get());
+		_replxx.history_add( utf8() );
 	} else {
 		_replxx.history_add("");
 	}
 	_history.reset_pos();
 
 	// display the prompt
-	if (!pi.write()) return -1;
+	OutputBuffer& out( _replxx.output() );
+	pi.write( out );
 
 #ifndef _WIN32
 	// we have to generate our own newline on line wrap on Linux
 	if (pi.promptIndentation == 0 && pi.promptExtraLines > 0)
-		if (write(1, "\n", 1) == -1) return -1;
+		out.write8("\n", 1);
 #endif
+	if (out.flush() == -1) return -1;
 
 	// the cursor starts out at the end of the prompt
 	pi.promptCursorRowOffset = pi.promptExtraLines;
+	invalidate_screen();
 
 	// kill and yank start in "other" mode
 	killRing.lastAction = KillRing::actionOther;
@@ -648,7 +1093,22 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 	while (true) {
 		int c;
 		if (terminatingKeystroke == -1) {
-			c = read_char();	// get a new keystroke
+			if ( _refreshPending ) {
+				refreshLine( pi );
+			}
+			if ( _hintsPending && ! input_pending( _replxx.hint_delay() ) ) {
+				// user stopped typing
+				refreshLine( pi, HINT_ACTION::REPAINT );
+			}
+			c = read_char( true );	// get a new keystroke
+
+			if ( c == ASYNC_RESULT ) {
+				// asynchronous hints arrived
+				if ( ! _hintsPending ) {
+					refreshLine( pi, HINT_ACTION::REPAINT );
+				}
+				continue;
+			}
 
 #ifndef _WIN32
 			if (c == 0 && gotResize) {
@@ -656,11 +1116,13 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 				// now redraw the prompt and line
 				gotResize = false;
 				pi.promptScreenColumns = getScreenColumns();
-				dynamicRefresh(pi, _buf32.get(), _len,
+				dynamicRefresh(_replxx.output(), pi, _buf32.get(), _len,
 											 _pos);	// redraw the original prompt with current input
+				invalidate_screen();
 				continue;
 			}
 #endif
+			_replxx.note_keystroke();
 		} else {
 			c = terminatingKeystroke;	 // use the terminating keystroke from search
 			terminatingKeystroke = -1;	// clear it once we've used it
@@ -678,7 +1140,8 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 		}
 
 		if (c == -2) {
-			if (!pi.write()) return -1;
+			pi.write(_replxx.output());
+			invalidate_screen();
 			refreshLine(pi);
 			continue;
 		}
@@ -751,7 +1214,8 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 				// so we don't display the next prompt over the previous input line
 				_pos = _len;	// pass _len as _pos for EOL
 				refreshLine(pi, HINT_ACTION::SKIP);
-				if (write(1, "^C", 2) == -1) return -1;	// Display the ^C we got
+				_replxx.output().write8("^C", 2);	// Display the ^C we got
+				_replxx.output().flush();
 				return -1;
 
 			case META + 'c':	// meta-C, give word initial Cap
@@ -765,12 +1229,14 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					if (_pos < _len && isCharacterAlphanumeric(_buf32[_pos])) {
 						if (_buf32[_pos] >= 'a' && _buf32[_pos] <= 'z') {
 							_buf32[_pos] += 'A' - 'a';
+							text_replaced( _pos, 1 );
 						}
 						++_pos;
 					}
 					while (_pos < _len && isCharacterAlphanumeric(_buf32[_pos])) {
 						if (_buf32[_pos] >= 'A' && _buf32[_pos] <= 'Z') {
 							_buf32[_pos] += 'a' - 'A';
+							text_replaced( _pos, 1 );
 						}
 						++_pos;
 					}
@@ -785,6 +1251,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 				if (_len > 0 && _pos < _len) {
 					_history.reset_recall_most_recent();
 					memmove(_buf32.get() + _pos, _buf32.get() + _pos + 1, sizeof(char32_t) * (_len - _pos));
+					text_erased( _pos, 1 );
 					--_len;
 					refreshLine(pi);
 				} else if (_len == 0) {
@@ -808,6 +1275,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					killRing.kill(&_buf32[_pos], endingPos - _pos, true);
 					memmove(_buf32.get() + _pos, _buf32.get() + endingPos,
 									sizeof(char32_t) * (_len - endingPos + 1));
+					text_erased( _pos, endingPos - _pos );
 					_len -= endingPos - _pos;
 					refreshLine(pi);
 				}
@@ -853,6 +1321,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					memmove(_buf32.get() + _pos - 1, _buf32.get() + _pos,
 									sizeof(char32_t) * (1 + _len - _pos));
 					--_pos;
+					text_erased( _pos, 1 );
 					--_len;
 					refreshLine(pi);
 				}
@@ -872,6 +1341,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					killRing.kill(&_buf32[_pos], startingPos - _pos, false);
 					memmove(_buf32.get() + _pos, _buf32.get() + startingPos,
 									sizeof(char32_t) * (_len - startingPos + 1));
+					text_erased( _pos, startingPos - _pos );
 					_len -= startingPos - _pos;
 					refreshLine(pi);
 				}
@@ -892,6 +1362,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 			case ctrlChar('K'):	// ctrl-K, kill from cursor to end of line
 				killRing.kill(&_buf32[_pos], _len - _pos, true);
 				_buf32[_pos] = '\0';
+				text_erased( _pos, _len - _pos );
 				_len = _pos;
 				refreshLine(pi);
 				killRing.lastAction = KillRing::actionKill;
@@ -913,6 +1384,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					while (_pos < _len && isCharacterAlphanumeric(_buf32[_pos])) {
 						if (_buf32[_pos] >= 'A' && _buf32[_pos] <= 'Z') {
 							_buf32[_pos] += 'a' - 'A';
+							text_replaced( _pos, 1 );
 						}
 						++_pos;
 					}
@@ -929,10 +1401,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 				// we don't
 				// have to special case it
 				if ( _history.is_last() ) {
-					size_t tempBufferSize = sizeof(char32_t) * _len + 1;
-					unique_ptr<char[]> tempBuffer(new char[tempBufferSize]);
-					copyString32to8(tempBuffer.get(), tempBufferSize, _buf32.get());
-					_history.update_last( tempBuffer.get() );
+					_history.update_last( utf8() );
 				}
 				if ( ! _history.is_empty() ) {
 					if (c == UP_ARROW_KEY) {
@@ -941,9 +1410,8 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					if ( ! _history.move( c == ctrlChar('P') ) ) {
 						break;
 					}
-					size_t ucharCount = 0;
-					copyString8to32(_buf32.get(), _buflen, ucharCount, _history.current().c_str());
-					_len = _pos = static_cast<int>(ucharCount);
+					set_text( _history.current().c_str() );
+					_pos = _len;
 					refreshLine(pi);
 				}
 				break;
@@ -982,6 +1450,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					char32_t aux = _buf32[leftCharPos];
 					_buf32[leftCharPos] = _buf32[leftCharPos + 1];
 					_buf32[leftCharPos + 1] = aux;
+					text_replaced( static_cast<int>( leftCharPos ), 2 );
 					if (_pos != _len) ++_pos;
 					refreshLine(pi);
 				}
@@ -993,6 +1462,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					killRing.kill(&_buf32[0], _pos, false);
 					_len -= _pos;
 					memmove(_buf32.get(), _buf32.get() + _pos, sizeof(char32_t) * (_len + 1));
+					text_erased( 0, _pos );
 					_pos = 0;
 					refreshLine(pi);
 				}
@@ -1010,6 +1480,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					while (_pos < _len && isCharacterAlphanumeric(_buf32[_pos])) {
 						if (_buf32[_pos] >= 'a' && _buf32[_pos] <= 'z') {
 							_buf32[_pos] += 'A' - 'a';
+							text_replaced( _pos, 1 );
 						}
 						++_pos;
 					}
@@ -1031,6 +1502,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					killRing.kill(&_buf32[_pos], startingPos - _pos, false);
 					memmove(_buf32.get() + _pos, _buf32.get() + startingPos,
 									sizeof(char32_t) * (_len - startingPos + 1));
+					text_erased( _pos, startingPos - _pos );
 					_len -= startingPos - _pos;
 					refreshLine(pi);
 				}
@@ -1044,14 +1516,16 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					if (restoredText) {
 						bool truncated = false;
 						size_t ucharCount = restoredText->length();
-						if (ucharCount > static_cast<size_t>(_buflen - _len)) {
-							ucharCount = _buflen - _len;
+						int room( reserve( static_cast<int>( ucharCount ) ) );
+						if ( static_cast<size_t>( room ) < ucharCount ) {
+							ucharCount = room;
 							truncated = true;
 						}
 						memmove(_buf32.get() + _pos + ucharCount, _buf32.get() + _pos,
 										sizeof(char32_t) * (_len - _pos + 1));
 						memmove(_buf32.get() + _pos, restoredText->get(),
 										sizeof(char32_t) * ucharCount);
+						text_inserted( _pos, static_cast<int>(ucharCount) );
 						_pos += static_cast<int>(ucharCount);
 						_len += static_cast<int>(ucharCount);
 						refreshLine(pi);
@@ -1074,9 +1548,10 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					if (restoredText) {
 						bool truncated = false;
 						size_t ucharCount = restoredText->length();
-						if (ucharCount >
-								static_cast<size_t>(killRing.lastYankSize + _buflen - _len)) {
-							ucharCount = killRing.lastYankSize + _buflen - _len;
+						int extra( static_cast<int>( ucharCount - killRing.lastYankSize ) );
+						int room( reserve( extra ) );
+						if ( room < extra ) {
+							ucharCount = killRing.lastYankSize + room;
 							truncated = true;
 						}
 						if (ucharCount > killRing.lastYankSize) {
@@ -1090,6 +1565,8 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 							memmove(_buf32.get() + _pos + ucharCount - killRing.lastYankSize,
 											_buf32.get() + _pos, sizeof(char32_t) * (_len - _pos + 1));
 						}
+						text_erased( _pos - static_cast<int>(killRing.lastYankSize), static_cast<int>(killRing.lastYankSize) );
+						text_inserted( _pos - static_cast<int>(killRing.lastYankSize), static_cast<int>(ucharCount) );
 						_pos += static_cast<int>(ucharCount - killRing.lastYankSize);
 						_len += static_cast<int>(ucharCount - killRing.lastYankSize);
 						killRing.lastYankSize = ucharCount;
@@ -1109,7 +1586,8 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 													 // mode
 				raise(SIGSTOP);		// Break out in mid-line
 				enableRawMode();	 // Back from Linux shell, re-enter raw mode
-				if (!pi.write()) break;	// Redraw prompt
+				pi.write(_replxx.output());	// Redraw prompt
+				invalidate_screen();
 				refreshLine(pi);				 // Refresh the line
 				break;
 #endif
@@ -1121,6 +1599,7 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 				if (_len > 0 && _pos < _len) {
 					_history.reset_recall_most_recent();
 					memmove(_buf32.get() + _pos, _buf32.get() + _pos + 1, sizeof(char32_t) * (_len - _pos));
+					text_erased( _pos, 1 );
 					--_len;
 					refreshLine(pi);
 				}
@@ -1135,20 +1614,27 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 				// we don't
 				// have to special case it
 				if ( _history.is_last() ) {
-					size_t tempBufferSize = sizeof(char32_t) * _len + 1;
-					unique_ptr<char[]> tempBuffer(new char[tempBufferSize]);
-					copyString32to8(tempBuffer.get(), tempBufferSize, _buf32.get());
-					_history.update_last( tempBuffer.get() );
+					_history.update_last( utf8() );
 				}
 				if ( ! _history.is_empty() ) {
 					_history.jump( (c == META + '<' || c == PAGE_UP_KEY) );
-					size_t ucharCount = 0;
-					copyString8to32(_buf32.get(), _buflen, ucharCount, _history.current().c_str());
-					_len = _pos = static_cast<int>(ucharCount);
+					set_text( _history.current().c_str() );
+					_pos = _len;
 					refreshLine(pi);
 				}
 				break;
 
+#ifndef _WIN32
+			case PASTE_START:	// bracketed paste, insert whole pasted text at once
+				killRing.lastAction = KillRing::actionOther;
+				_history.reset_recall_most_recent();
+				paste(pi);
+				break;
+
+			case PASTE_FINISH:	// stray end of paste marker
+				break;
+#endif
+
 			// not one of our special characters, maybe insert it in the buffer
 			default:
 				killRing.lastAction = KillRing::actionOther;
@@ -1157,32 +1643,41 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 					beep();
 					break;
 				}
-				if (_len < _buflen) {
+				if ( reserve( 1 ) == 1 ) {
 					if (isControlChar(c)) {	// don't insert control characters
 						beep();
 						break;
 					}
 					if (_len == _pos) {	// at end of buffer
 						_buf32[_pos] = c;
+						text_inserted( _pos, 1 );
 						++_pos;
 						++_len;
 						_buf32[_len] = '\0';
-						int inputLen = calculateColumnPosition(_buf32.get(), _len);
-						if ( ! _replxx.has_highlighter() && ( pi.promptIndentation + inputLen < pi.promptScreenColumns ) ) {
+#ifdef _WIN32
+						int inputLen = _charWidths.column( _len );
+						if ( ! _refreshPending && ! _replxx.has_highlighter() && ( pi.promptIndentation + inputLen < pi.promptScreenColumns ) ) {
 							if (inputLen > pi.promptPreviousInputLen)
 								pi.promptPreviousInputLen = inputLen;
 							/* Avoid a full update of the line in the
 							 * trivial case. */
-							if (write32(1, reinterpret_cast<char32_t*>(&c), 1) == -1)
+							_replxx.output().write32(reinterpret_cast<char32_t*>(&c), 1);
+							if (_replxx.output().flush() == -1)
 								return -1;
 						} else {
 							refreshLine(pi);
 						}
+#else
+						/* Differential refresh writes only the new character
+						 * in the trivial case. */
+						refreshLine(pi);
+#endif
 					} else {	// not at end of buffer, have to move characters to our
 										// right
 						memmove(_buf32.get() + _pos + 1, _buf32.get() + _pos,
 										sizeof(char32_t) * (_len - _pos));
 						_buf32[_pos] = c;
+						text_inserted( _pos, 1 );
 						++_len;
 						++_pos;
 						_buf32[_len] = '\0';
@@ -1202,18 +1697,14 @@ int InputBuffer::getInputLine(PromptBase& pi) {
 
 void InputBuffer::commonPrefixSearch(PromptBase& pi, int startChar) {
 	killRing.lastAction = KillRing::actionOther;
-	size_t bufferSize = sizeof(char32_t) * length() + 1;
-	unique_ptr<char[]> buf8(new char[bufferSize]);
-	copyString32to8(buf8.get(), bufferSize, buf());
-	int prefixSize( calculateColumnPosition( _buf32.get(), _prefix ) );
+	int prefixSize( _charWidths.column( _prefix ) );
 	if (
 		_history.common_prefix_search(
-			buf8.get(), prefixSize, ( startChar == ( META + 'p' ) ) || ( startChar == ( META + 'P' ) )
+			utf8(), prefixSize, ( startChar == ( META + 'p' ) ) || ( startChar == ( META + 'P' ) )
 		)
 	) {
-		size_t ucharCount = 0;
-		copyString8to32( buf(), _buflen, ucharCount, _history.current().c_str() );
-		_len = _pos = static_cast<int>(ucharCount);
+		set_text( _history.current().c_str() );
+		_pos = _len;
 		refreshLine(pi);
 	}
 }
@@ -1231,27 +1722,21 @@ void InputBuffer::commonPrefixSearch(PromptBase& pi, int startChar) {
  * direction
  */
 int InputBuffer::incrementalHistorySearch(PromptBase& pi, int startChar) {
-	size_t bufferSize;
-	size_t ucharCount = 0;
-
 	// if not already recalling, add the current line to the history list so we
 	// don't have to
 	// special case it
 	if ( _history.is_last() ) {
-		bufferSize = sizeof(char32_t) * _len + 1;
-		unique_ptr<char[]> tempBuffer(new char[bufferSize]);
-		copyString32to8(tempBuffer.get(), bufferSize, _buf32.get());
-		_history.update_last( tempBuffer.get() );
+		_history.update_last( utf8() );
 	}
 	int historyLineLength = _len;
 	int historyLinePosition = _pos;
-	InputBuffer empty( _replxx, 1 );
-	empty.refreshLine(pi); // erase the old input first
+	erase_input( pi ); // erase the old input first
+	_refreshPending = false; // search prompt replaces the input display
 	DynamicPrompt dp(pi, (startChar == ctrlChar('R')) ? -1 : 1);
 
 	dp.promptPreviousLen = pi.promptPreviousLen;
 	dp.promptPreviousInputLen = pi.promptPreviousInputLen;
-	dynamicRefresh(dp, _buf32.get(), historyLineLength,
+	dynamicRefresh(_replxx.output(), dp, _buf32.get(), historyLineLength,
 								 historyLinePosition);	// draw user's text with our prompt
 
 	// loop until we get an exit character
@@ -1259,7 +1744,7 @@ int InputBuffer::incrementalHistorySearch(PromptBase& pi, int startChar) {
 	bool keepLooping = true;
 	bool useSearchedLine = true;
 	bool searchAgain = false;
-	char32_t* activeHistoryLine = 0;
+	Utf32String const* activeHistoryLine = nullptr;
 	while (keepLooping) {
 		c = read_char();
 		c = cleanupCtrl(c);	// convert CTRL + <char> into normal ctrl
@@ -1345,14 +1830,8 @@ int InputBuffer::incrementalHistorySearch(PromptBase& pi, int startChar) {
 													 // mode
 				raise(SIGSTOP);		// Break out in mid-line
 				enableRawMode();	 // Back from Linux shell, re-enter raw mode
-				{
-					bufferSize = historyLineLength + 1;
-					unique_ptr<char32_t[]> tempUnicode(new char32_t[bufferSize]);
-					copyString8to32(tempUnicode.get(), bufferSize, ucharCount,
-													_history.current().c_str());
-					dynamicRefresh(dp, tempUnicode.get(), historyLineLength,
-												 historyLinePosition);
-				}
+				dynamicRefresh(_replxx.output(), dp, _history.current_unicode().get(), historyLineLength,
+											 historyLinePosition);
 				continue;
 				break;
 #endif
@@ -1375,6 +1854,10 @@ int InputBuffer::incrementalHistorySearch(PromptBase& pi, int startChar) {
 			case ctrlChar('Y'):	// ctrl-Y, yank killed text
 				break;
 
+			case PASTE_START:	// pasted text is searched for character by character
+			case PASTE_FINISH:
+				break;
+
 			default:
 				if (!isControlChar(c) && c <= 0x0010FFFF) {	// not an action character
 					unique_ptr<char32_t[]> tempUnicode(
@@ -1391,66 +1874,25 @@ int InputBuffer::incrementalHistorySearch(PromptBase& pi, int startChar) {
 
 		// if we are staying in search mode, search now
 		if (keepLooping) {
-			bufferSize = historyLineLength + 1;
-			if (activeHistoryLine) {
-				delete[] activeHistoryLine;
-				activeHistoryLine = nullptr;
-			}
-			activeHistoryLine = new char32_t[bufferSize];
-			copyString8to32(activeHistoryLine, bufferSize, ucharCount,
-											_history.current().c_str());
 			if (dp.searchTextLen > 0) {
-				bool found = false;
+				// lines are looked up in the history search index,
+				// so the cost depends on number of candidate lines, not on size of the history
 				int historySearchIndex = _history.current_pos();
-				int lineLength = static_cast<int>(ucharCount);
 				int lineSearchPos = historyLinePosition;
 				if (searchAgain) {
 					lineSearchPos += dp.direction;
 				}
 				searchAgain = false;
-				while (true) {
-					while ((dp.direction > 0) ? (lineSearchPos < lineLength)
-																		: (lineSearchPos >= 0)) {
-						if (strncmp32(dp.searchText.get(),
-													&activeHistoryLine[lineSearchPos],
-													dp.searchTextLen) == 0) {
-							found = true;
-							break;
-						}
-						lineSearchPos += dp.direction;
-					}
-					if (found) {
-						_history.reset_pos( historySearchIndex );
-						historyLineLength = lineLength;
-						historyLinePosition = lineSearchPos;
-						break;
-					} else if ((dp.direction > 0) ? (historySearchIndex < _history.size())
-																				: (historySearchIndex > 0)) {
-						historySearchIndex += dp.direction;
-						bufferSize = _history[historySearchIndex].length() + 1;
-						delete[] activeHistoryLine;
-						activeHistoryLine = nullptr;
-						activeHistoryLine = new char32_t[bufferSize];
-						copyString8to32(activeHistoryLine, bufferSize, ucharCount,
-														_history[historySearchIndex].c_str());
-						lineLength = static_cast<int>(ucharCount);
-						lineSearchPos =
-								(dp.direction > 0) ? 0 : (lineLength - dp.searchTextLen);
-					} else {
-						beep();
-						break;
-					}
-				};	// while
-			}
-			if (activeHistoryLine) {
-				delete[] activeHistoryLine;
-				activeHistoryLine = nullptr;
+				if (_history.search(dp.searchText.get(), dp.searchTextLen, dp.direction > 0, historySearchIndex, lineSearchPos)) {
+					_history.reset_pos( historySearchIndex );
+					historyLinePosition = lineSearchPos;
+				} else {
+					beep();
+				}
 			}
-			bufferSize = historyLineLength + 1;
-			activeHistoryLine = new char32_t[bufferSize];
-			copyString8to32(activeHistoryLine, bufferSize, ucharCount,
-											_history.current().c_str());
-			dynamicRefresh(dp, activeHistoryLine, historyLineLength,
+			activeHistoryLine = &_history.current_unicode();
+			historyLineLength = static_cast<int>(activeHistoryLine->length());
+			dynamicRefresh(_replxx.output(), dp, activeHistoryLine->get(), historyLineLength,
 										 historyLinePosition); // draw user's text with our prompt
 		}
 	}	// while
@@ -1465,7 +1907,7 @@ int InputBuffer::incrementalHistorySearch(PromptBase& pi, int startChar) {
 	copyString32(tempUnicode.get(), &pi.promptText[pi.promptLastLinePosition],
 							 pb.promptBytes - pi.promptLastLinePosition);
 	tempUnicode.initFromBuffer();
-	pb.promptText = tempUnicode;
+	pb.promptText = std::move( tempUnicode );
 	pb.promptExtraLines = 0;
 	pb.promptIndentation = pi.promptIndentation;
 	pb.promptLastLinePosition = 0;
@@ -1475,15 +1917,11 @@ int InputBuffer::incrementalHistorySearch(PromptBase& pi, int startChar) {
 	pb.promptPreviousLen = dp.promptChars;
 	if (useSearchedLine && activeHistoryLine) {
 		_history.set_recall_most_recent();
-		copyString32(_buf32.get(), activeHistoryLine, _buflen + 1);
-		_len = historyLineLength;
-		_prefix = _pos = historyLinePosition;
-	}
-	if (activeHistoryLine) {
-		delete[] activeHistoryLine;
-		activeHistoryLine = nullptr;
+		set_text( activeHistoryLine->get(), historyLineLength );
+		_prefix = _pos = min(historyLinePosition, _len);
 	}
-	dynamicRefresh(pb, _buf32.get(), _len, _pos);	// redraw the original prompt with current input
+	dynamicRefresh(_replxx.output(), pb, _buf32.get(), _len, _pos);	// redraw the original prompt with current input
+	invalidate_screen();
 	pi.promptPreviousInputLen = _len;
 	pi.promptCursorRowOffset = pi.promptExtraLines + pb.promptCursorRowOffset;
 	previousSearchText =
@@ -1493,26 +1931,29 @@ int InputBuffer::incrementalHistorySearch(PromptBase& pi, int startChar) {
 
 void InputBuffer::clearScreen(PromptBase& pi) {
 	_replxx.clear_screen();
-	if (!pi.write()) return;
+	OutputBuffer& out( _replxx.output() );
+	pi.write( out );
 #ifndef _WIN32
 	// we have to generate our own newline on line wrap on Linux
 	if (pi.promptIndentation == 0 && pi.promptExtraLines > 0)
-		if (write(1, "\n", 1) == -1) return;
+		out.write8("\n", 1);
 #endif
 	pi.promptCursorRowOffset = pi.promptExtraLines;
-	refreshLine(pi);
+	invalidate_screen();
+	refreshLine( pi, HINT_ACTION::REPAINT );
 }
 
 /**
  * Display the dynamic incremental search prompt and the current user input
  * line.
+ * @param out	output buffer collecting the frame
  * @param pi	 PromptBase struct holding information about the prompt and our
  * screen position
  * @param buf32	input buffer to be displayed
  * @param len	count of characters in the buffer
  * @param pos	current cursor position within the buffer (0 <= pos <= len)
  */
-void dynamicRefresh(PromptBase& pi, char32_t* buf32, int len, int pos) {
+void dynamicRefresh(OutputBuffer& out, PromptBase& pi, char32_t const* buf32, int len, int pos) {
 	// calculate the position of the end of the prompt
 	int xEndOfPrompt, yEndOfPrompt;
 	calculateScreenPosition(0, 0, pi.promptScreenColumns, pi.promptChars,
@@ -1532,6 +1973,7 @@ void dynamicRefresh(PromptBase& pi, char32_t* buf32, int len, int pos) {
 													yCursorPos);
 
 #ifdef _WIN32
+	if (out.flush() == -1) return;
 	// position at the start of the prompt, clear to end of previous input
 	CONSOLE_SCREEN_BUFFER_INFO inf;
 	GetConsoleScreenBufferInfo(console_out, &inf);
@@ -1546,10 +1988,11 @@ void dynamicRefresh(PromptBase& pi, char32_t* buf32, int len, int pos) {
 	pi.promptPreviousInputLen = len;
 
 	// display the prompt
-	if (!pi.write()) return;
+	pi.write(out);
 
 	// display the input line
-	if (write32(1, buf32, len) == -1) return;
+	out.write32(buf32, len);
+	if (out.flush() == -1) return;
 
 	// position the cursor
 	GetConsoleScreenBufferInfo(console_out, &inf);
@@ -1561,31 +2004,31 @@ void dynamicRefresh(PromptBase& pi, char32_t* buf32, int len, int pos) {
 	int cursorRowMovement = pi.promptCursorRowOffset - pi.promptExtraLines;
 	if (cursorRowMovement > 0) {	// move the cursor up as required
 		snprintf(seq, sizeof seq, "\x1b[%dA", cursorRowMovement);
-		if (write(1, seq, strlen(seq)) == -1) return;
+		out.write8(seq);
 	}
 	// position at the start of the prompt, clear to end of screen
-	snprintf(seq, sizeof seq, "\x1b[1G\x1b[J");	// 1-based on VT100
-	if (write(1, seq, strlen(seq)) == -1) return;
+	out.write8("\x1b[1G\x1b[J");	// 1-based on VT100
 
 	// display the prompt
-	if (!pi.write()) return;
+	pi.write(out);
 
 	// display the input line
-	if (write32(1, buf32, len) == -1) return;
+	out.write32(buf32, len);
 
 	// we have to generate our own newline on line wrap
 	if (xEndOfInput == 0 && yEndOfInput > 0)
-		if (write(1, "\n", 1) == -1) return;
+		out.write8("\n", 1);
 
 	// position the cursor
 	cursorRowMovement = yEndOfInput - yCursorPos;
 	if (cursorRowMovement > 0) {	// move the cursor up as required
 		snprintf(seq, sizeof seq, "\x1b[%dA", cursorRowMovement);
-		if (write(1, seq, strlen(seq)) == -1) return;
+		out.write8(seq);
 	}
 	// position the cursor within the line
 	snprintf(seq, sizeof seq, "\x1b[%dG", xCursorPos + 1);	// 1-based on VT100
-	if (write(1, seq, strlen(seq)) == -1) return;
+	out.write8(seq);
+	if (out.flush() == -1) return;
 #endif
 
 	pi.promptCursorRowOffset =
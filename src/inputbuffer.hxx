@@ -3,10 +3,13 @@
 
 #include <vector>
 #include <memory>
+#include <string>
 
 #include "replxx.hxx"
 #include "replxx_impl.hxx"
 #include "prompt.hxx"
+#include "charwidths.hxx"
+#include "brackets.hxx"
 
 namespace replxx {
 
@@ -15,57 +18,166 @@ struct PromptBase;
 class InputBuffer {
 public:
 	typedef std::unique_ptr<char32_t[]> input_buffer_t;
-	typedef std::unique_ptr<char[]> char_widths_t;
 	typedef std::vector<char32_t> display_t;
+	static int const INITIAL_CAPACITY = 256;
 	enum class HINT_ACTION {
 		REGENERATE,
 		REPAINT,
 		SKIP
 	};
+	/*! \brief Retained model of what previous refresh put on the terminal.
+	 *
+	 * Positions are relative to the end of the prompt,
+	 * i.e. row 0 is the row where user input starts.
+	 */
+	struct Screen {
+		struct Position {
+			int x;     // screen position of the character
+			int y;
+			int sgr;   // start of escape sequence setting color in effect at the character, -1 if none
+			int start; // start of escape sequence the character is a part of, the character itself otherwise
+			int base;  // last preceding character that is not zero width
+		};
+		typedef std::vector<Position> positions_t;
+		display_t frame;   // characters and escape sequences written by previous refresh
+		positions_t positions; // one for each character of the frame and one just past it
+		int endX;          // screen position just past the frame
+		int endY;
+		int cursorX;       // cursor column left by previous refresh
+		int indentation;   // prompt geometry the frame was painted with
+		int columns;
+		bool valid;
+		Screen( void )
+			: frame()
+			, positions()
+			, endX( 0 )
+			, endY( 0 )
+			, cursorX( 0 )
+			, indentation( 0 )
+			, columns( 0 )
+			, valid( false ) {
+		}
+	};
 private:
 	Replxx::ReplxxImpl& _replxx;
 	input_buffer_t _buf32;      // input buffer
-	char_widths_t  _charWidths; // character widths from mk_wcwidth()
+	CharWidths     _charWidths; // character widths from mk_wcwidth(), kept in sync with _buf32
+	Brackets       _brackets;   // bracket structure, brought up to date with _buf32 when queried
 	display_t      _display;
+	Replxx::Color  _displayColor;    // color in effect at the end of _display
+	Replxx::Color  _colorBeforeCode; // color in effect before the last color code
+	int            _colorCodeStart;  // position of the last color code in _display
+	int            _colorCodeEnd;    // end of the last color code, -1 if text followed it
+	Screen         _screen;
 	Utf32String    _hint;
-	int _buflen; // buffer size in characters
+	Replxx::colors_t _colors;   // colors from incremental highlighter, kept in sync with _buf32
+	Replxx::colors_t _displayColors; // colors of input characters in current refresh, storage is reused
+	std::vector<int> _completionLengths; // code points in each listed completion
+	int _editPos;      // net change of the input since last incremental highlighting,
+	int _editRemoved;  // -1 in _editPos if there was none
+	int _editInserted;
+	std::string _utf8;   // UTF-8 copy of _buf32 given to callbacks
+	int _utf8Chars;      // number of characters encoded in _utf8
+	int _utf8Dirty;      // first character changed since _utf8 was updated
+	int _utf8Cut;        // byte temporarily replaced with terminator, -1 if none
+	char _utf8CutByte;
+	int _buflen; // buffer size in characters, grows as needed
+	int _maxLen; // maximum length of text, 0 if not limited
 	int _len;    // length of text in input buffer
 	int _pos;    // character position in buffer ( 0 <= _pos <= _len )
 	int _prefix; // prefix length used in common prefix search
 	int _hintSelection; // Currently selected hint.
+	bool _refreshPending; // refresh was put off because more input was waiting
+	bool _hintsPending;   // hints were put off until user stops typing
 	History& _history;
 
 	void clearScreen(PromptBase& pi);
 	int incrementalHistorySearch(PromptBase& pi, int startChar);
 	void commonPrefixSearch(PromptBase& pi, int startChar);
 	int completeLine(PromptBase& pi);
+#ifndef _WIN32
+	void paste(PromptBase& pi);
+#endif
 	void refreshLine(PromptBase& pi, HINT_ACTION = HINT_ACTION::REGENERATE);
+	void erase_input( PromptBase& );
+	void paint( PromptBase&, char32_t const*, int, int, int );
+	void invalidate_screen( void ) {
+		_screen.valid = false;
+	}
 	void highlight( int, bool );
+	void text_inserted( int, int );
+	void text_erased( int, int );
+	void text_replaced( int, int );
+	void text_reset( void );
+	void note_edit( int, int, int );
+	int reserve( int );
+	void grow( int );
+	void set_text( char const* );
+	void set_text( char32_t const*, int );
+	Replxx::InputView input_view( int );
+	int utf8_offset( int );
 	int handle_hints( PromptBase&, HINT_ACTION );
 	void setColor( Replxx::Color );
 	int start_index( void );
 
  public:
-	InputBuffer( Replxx::ReplxxImpl& replxx_, int bufferLen )
+	InputBuffer( Replxx::ReplxxImpl& replxx_, int maxLen_ )
 		: _replxx( replxx_ )
-		, _buf32(new char32_t[bufferLen])
-		, _charWidths(new char[bufferLen])
+		, _buf32( new char32_t[INITIAL_CAPACITY + 1] )
+		, _charWidths()
+		, _brackets()
 		, _display()
+		, _displayColor( Replxx::Color::DEFAULT )
+		, _colorBeforeCode( Replxx::Color::DEFAULT )
+		, _colorCodeStart( 0 )
+		, _colorCodeEnd( -1 )
+		, _screen()
 		, _hint()
-		, _buflen(bufferLen - 1)
+		, _colors()
+		, _displayColors()
+		, _completionLengths()
+		, _editPos( -1 )
+		, _editRemoved( 0 )
+		, _editInserted( 0 )
+		, _utf8()
+		, _utf8Chars( 0 )
+		, _utf8Dirty( 0 )
+		, _utf8Cut( -1 )
+		, _utf8CutByte( 0 )
+		, _buflen( INITIAL_CAPACITY )
+		, _maxLen( maxLen_ )
 		, _len(0)
 		, _pos(0)
 		, _prefix( 0 )
 		, _hintSelection( -1 )
+		, _refreshPending( false )
+		, _hintsPending( false )
 		, _history( replxx_.history() ) {
 		_buf32[0] = 0;
 	}
+	void reset( int maxLen_ );
 	void preloadBuffer( char const* preloadText );
 	int getInputLine(PromptBase& pi);
 	int length(void) const { return _len; }
 	char32_t* buf() {
 		return ( _buf32.get() );
 	}
+	/*! \brief Get whole text as null terminated UTF-8.
+	 *
+	 * The text is kept up to date while it is edited,
+	 * the pointer is valid until next change of the text.
+	 */
+	char const* utf8( void ) {
+		return ( input_view( _len ).data() );
+	}
+	int matching_bracket( int pos_ ) {
+		_brackets.set_quotes( _replxx.quote_characters() );
+		return ( _brackets.match( _buf32.get(), _len, pos_ ) );
+	}
+	bool is_quoted( int pos_ ) {
+		_brackets.set_quotes( _replxx.quote_characters() );
+		return ( _brackets.quoted( _buf32.get(), _len, pos_ ) );
+	}
 };
 
 }
@@ -1,5 +1,6 @@
 #include <memory>
 #include <cerrno>
+#include <cstring>
 #include <cstdlib>
 
 #ifdef _WIN32
@@ -22,6 +23,8 @@
 #include <unistd.h>
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <poll.h>
+#include <fcntl.h>
 
 #endif /* _WIN32 */
 
@@ -41,8 +44,10 @@ static DWORD oldMode;
 static WORD oldDisplayAttribute;
 static UINT const inputCodePage( GetConsoleCP() );
 static UINT const outputCodePage( GetConsoleOutputCP() );
+static HANDLE const wakeupEvent( CreateEvent( nullptr, FALSE, FALSE, nullptr ) );
 #else
 static struct termios orig_termios; /* in order to restore at exit */
+static int wakeupPipe[2] = { -1, -1 }; /* written by wakeup(), polled by read_char() */
 #endif
 
 static int rawmode = 0; /* for atexit() function to check if restore is needed*/
@@ -74,32 +79,71 @@ bool err( is_a_tty( 2 ) );
 
 }
 
-int write32( int fd, char32_t* text32, int len32 ) {
-#ifdef _WIN32
-	if ( ( fd == 1 ) ? tty::out : tty::err ) {
-		size_t len16 = 2 * len32 + 1;
-		unique_ptr<char16_t[]> text16(new char16_t[len16]);
-		size_t count16 = WinWrite32(text16.get(), text32, len32);
+OutputBuffer::OutputBuffer( void )
+	: _data()
+	, _written( 0 ) {
+}
 
-		return static_cast<int>(count16);
-	} else {
-		size_t len8 = 4 * len32 + 1;
-		unique_ptr<char[]> text8(new char[len8]);
-		size_t count8 = 0;
+void OutputBuffer::write8( char const* text8_, int len8_ ) {
+	_data.insert( _data.end(), text8_, text8_ + len8_ );
+}
+
+void OutputBuffer::write8( char const* text8_ ) {
+	write8( text8_, static_cast<int>( strlen( text8_ ) ) );
+}
 
-		copyString32to8(text8.get(), len8, &count8, text32, len32);
+/**
+ * Encode UTF-32 text directly into the buffer.
+ *
+ * Buffer storage is kept across flushes so once it has grown to the size
+ * of a typical frame no further allocations happen.
+ */
+void OutputBuffer::write32( char32_t const* text32_, int len32_ ) {
+	// conversion has a vectorized fast path for ASCII runs
+	size_t used( _data.size() );
+	size_t len8( 4 * len32_ + 1 );
+	_data.resize( used + len8 );
+	size_t count8( 0 );
+	copyString32to8( _data.data() + used, len8, &count8, text32_, len32_ );
+	_data.resize( used + count8 );
+}
 
-		return write(fd, text8.get(), static_cast<unsigned int>(count8));
+/**
+ * Send everything collected so far to the terminal.
+ *
+ * @return number of bytes written or -1 on error
+ */
+int OutputBuffer::flush( void ) {
+	if ( _data.empty() ) {
+		return ( 0 );
+	}
+	int count( 0 );
+#ifdef _WIN32
+	if ( tty::out ) {
+		count = win_print( _data.data(), static_cast<int>( _data.size() ) );
+	} else {
+		count = write( 1, _data.data(), static_cast<unsigned int>( _data.size() ) );
 	}
 #else
-	size_t len8 = 4 * len32 + 1;
-	unique_ptr<char[]> text8(new char[len8]);
-	size_t count8 = 0;
-
-	copyString32to8(text8.get(), len8, &count8, text32, len32);
-
-	return write(fd, text8.get(), count8);
+	int size( static_cast<int>( _data.size() ) );
+	while ( count < size ) {
+		int w( static_cast<int>( write( 1, _data.data() + count, static_cast<size_t>( size - count ) ) ) );
+		if ( w == -1 ) {
+			if ( errno == EINTR ) {
+				continue;
+			}
+			count = -1;
+			break;
+		}
+		count += w;
+	}
 #endif
+	_data.clear();
+	if ( count == -1 ) {
+		return ( -1 );
+	}
+	_written += count;
+	return ( count );
 }
 
 int getScreenColumns(void) {
@@ -215,6 +259,16 @@ int enableRawMode(void) {
 	/* put terminal in raw mode after flushing */
 	if (tcsetattr(0, TCSADRAIN, &raw) < 0) goto fatal;
 	rawmode = 1;
+	if ( ( wakeupPipe[0] == -1 ) && ( pipe( wakeupPipe ) == 0 ) ) {
+		for ( int fd : wakeupPipe ) {
+			fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+			fcntl( fd, F_SETFD, FD_CLOEXEC );
+		}
+	}
+	/* let terminal mark pasted text so it can be inserted in one go */
+	if ( tty::out ) {
+		static_cast<void>( write( 1, "\x1b[?2004h", 8 ) >= 0 );
+	}
 	return 0;
 
 fatal:
@@ -231,55 +285,172 @@ void disableRawMode(void) {
 	console_in = 0;
 	console_out = 0;
 #else
+	if ( rawmode && tty::out ) {
+		static_cast<void>( write( 1, "\x1b[?2004l", 8 ) >= 0 );
+	}
 	if (rawmode && tcsetattr(0, TCSADRAIN, &orig_termios) != -1) rawmode = 0;
 #endif
 }
 
 #ifndef _WIN32
 
+namespace {
+
+// bytes read from the terminal but not consumed yet, keystrokes are read
+// one byte at a time so input typed ahead past the end of the line is left
+// to the application, text of a paste is read in blocks, see read_ahead()
+char8_t inputBuffer[4096];
+int inputBufferPos = 0;
+int inputBufferLen = 0;
+bool readAhead = false;
+
+/**
+ * Get next byte of terminal input, refill the input buffer if it is exhausted.
+ *
+ * @return	next byte or -1 on end of input or error
+ */
+int read_byte( void ) {
+	if ( inputBufferPos == inputBufferLen ) {
+		ssize_t nread;
+		do {
+			nread = read( 0, inputBuffer, readAhead ? sizeof ( inputBuffer ) : 1 );
+		} while ( ( nread == -1 ) && ( errno == EINTR ) );
+		if ( nread <= 0 ) {
+			return ( -1 );
+		}
+		inputBufferPos = 0;
+		inputBufferLen = static_cast<int>( nread );
+	}
+	return ( inputBuffer[inputBufferPos ++] );
+}
+
+/**
+ * Wait until there is terminal input or until wakeup() is called.
+ *
+ * Keystrokes take precedence, a wakeup is reported only when no input is pending.
+ *
+ * @return	true if terminal input is available, false when woken up
+ */
+bool wait_input( void ) {
+	if ( ( inputBufferPos < inputBufferLen ) || ( wakeupPipe[0] == -1 ) ) {
+		return ( true );
+	}
+	pollfd fds[] = { { 0, POLLIN, 0 }, { wakeupPipe[0], POLLIN, 0 } };
+	while ( poll( fds, 2, -1 ) == -1 ) {
+		if ( errno != EINTR ) {
+			return ( true );
+		}
+	}
+	if ( fds[0].revents != 0 ) {
+		return ( true );
+	}
+	char buf[64];
+	while ( read( wakeupPipe[0], buf, sizeof ( buf ) ) > 0 ) {
+	}
+	return ( false );
+}
+
+}
+
+/**
+ * Let terminal input be read in blocks, while more of it is known to follow
+ * (e.g. until the end of a bracketed paste).  Bytes read past that point
+ * stay buffered for following keystrokes of the same line.
+ */
+void read_ahead( bool readAhead_ ) {
+	readAhead = readAhead_;
+}
+
 /**
  * Read a UTF-8 sequence from the non-Windows keyboard and return the Unicode
  * (char32_t) character it
  * encodes
  *
+ * Malformed sequences are skipped.
+ *
  * @return	char32_t Unicode character
  */
 char32_t readUnicodeCharacter(void) {
-	static char8_t utf8String[5];
-	static size_t utf8Count = 0;
+	static char32_t const minValue[] = { 0, 0x80, 0x800, 0x10000 };
 	while (true) {
-		char8_t c;
-
-		/* Continue reading if interrupted by signal. */
-		ssize_t nread;
-		do {
-			nread = read(0, &c, 1);
-		} while ((nread == -1) && (errno == EINTR));
-
-		if (nread <= 0) return 0;
+		int c( read_byte() );
+		if (c < 0) return 0;
 		if (c <= 0x7F || locale::is8BitEncoding) {	// short circuit ASCII
-			utf8Count = 0;
-			return c;
-		} else if (utf8Count < sizeof(utf8String) - 1) {
-			utf8String[utf8Count++] = c;
-			utf8String[utf8Count] = 0;
-			char32_t unicodeChar[2];
-			size_t ucharCount;
-			ConversionResult res =
-					copyString8to32(unicodeChar, 2, ucharCount, utf8String);
-			if (res == conversionOK && ucharCount) {
-				utf8Count = 0;
-				return unicodeChar[0];
-			}
+			return static_cast<char32_t>( c );
+		}
+		int more( 0 );
+		char32_t unicodeChar( 0 );
+		if ( ( c & 0xE0 ) == 0xC0 ) {
+			more = 1;
+			unicodeChar = c & 0x1F;
+		} else if ( ( c & 0xF0 ) == 0xE0 ) {
+			more = 2;
+			unicodeChar = c & 0x0F;
+		} else if ( ( c & 0xF8 ) == 0xF0 ) {
+			more = 3;
+			unicodeChar = c & 0x07;
 		} else {
-			utf8Count =
-					0;	// this shouldn't happen: got four bytes but no UTF-8 character
+			continue;	// stray continuation byte or invalid lead byte
+		}
+		int length( more );
+		while ( more > 0 ) {
+			c = read_byte();
+			if (c < 0) return 0;
+			if ( ( c & 0xC0 ) != 0x80 ) {
+				-- inputBufferPos;	// not a part of this sequence, process it again
+				break;
+			}
+			unicodeChar = ( unicodeChar << 6 ) | ( c & 0x3F );
+			-- more;
+		}
+		if (
+			( more == 0 )
+			&& ( unicodeChar >= minValue[length] )
+			&& ( unicodeChar <= 0x10FFFF )
+			&& ( ( unicodeChar < 0xD800 ) || ( unicodeChar > 0xDFFF ) )
+		) {
+			return unicodeChar;
 		}
 	}
 }
 
 #endif	// #ifndef _WIN32
 
+/**
+ * Check if a keystroke is waiting to be read, optionally wait for one.
+ *
+ * @param timeoutMs_	how long to wait for input, 0 to only check
+ * @return	true if read_char() would not block
+ */
+bool input_pending( int timeoutMs_ ) {
+#ifdef _WIN32
+	DWORD const start( GetTickCount() );
+	while ( true ) {
+		INPUT_RECORD rec;
+		DWORD count( 0 );
+		while ( PeekConsoleInputW( console_in, &rec, 1, &count ) && ( count > 0 ) ) {
+			if (
+				( rec.EventType == KEY_EVENT )
+				&& ( rec.Event.KeyEvent.bKeyDown || ( rec.Event.KeyEvent.wVirtualKeyCode == VK_MENU ) )
+			) {
+				return ( true );
+			}
+			ReadConsoleInputW( console_in, &rec, 1, &count );	// read_char() would skip it anyway
+		}
+		int elapsed( static_cast<int>( GetTickCount() - start ) );
+		if ( ( elapsed >= timeoutMs_ ) || ( WaitForSingleObject( console_in, timeoutMs_ - elapsed ) != WAIT_OBJECT_0 ) ) {
+			return ( false );
+		}
+	}
+#else
+	if ( inputBufferPos < inputBufferLen ) {
+		return ( true );
+	}
+	pollfd fd = { 0, POLLIN, 0 };
+	return ( poll( &fd, 1, timeoutMs_ ) > 0 );
+#endif
+}
+
 void beep() {
 	fprintf(stderr, "\x7");	// ctrl-G == bell/beep
 	fflush(stderr);
@@ -294,7 +465,9 @@ void beep() {
 // A return value of zero means "no input available", and a return value of -1
 // means "invalid key".
 //
-char32_t read_char(void) {
+// With wakeable set a call to wakeup() makes it return ASYNC_RESULT.
+//
+char32_t read_char( bool wakeable_ ) {
 #ifdef _WIN32
 
 	INPUT_RECORD rec;
@@ -302,6 +475,12 @@ char32_t read_char(void) {
 	int modifierKeys = 0;
 	bool escSeen = false;
 	while (true) {
+		if ( wakeable_ ) {
+			HANDLE handles[] = { console_in, wakeupEvent };
+			if ( WaitForMultipleObjects( 2, handles, FALSE, INFINITE ) == ( WAIT_OBJECT_0 + 1 ) ) {
+				return ( ASYNC_RESULT );
+			}
+		}
 		ReadConsoleInputW(console_in, &rec, 1, &count);
 #if 0	// helper for debugging keystrokes, display info in the debug "Output"
 			 // window in the debugger
@@ -403,6 +582,9 @@ char32_t read_char(void) {
 	}
 
 #else
+	if ( wakeable_ && ! wait_input() ) {
+		return ( ASYNC_RESULT );
+	}
 	char32_t c;
 	c = readUnicodeCharacter();
 	if (c == 0) return 0;
@@ -471,6 +653,19 @@ char32_t read_char(void) {
 #endif	// #_WIN32
 }
 
+/**
+ * Interrupt wakeable read_char(), safe to call from any thread.
+ */
+void wakeup( void ) {
+#ifdef _WIN32
+	SetEvent( wakeupEvent );
+#else
+	if ( wakeupPipe[1] != -1 ) {
+		static_cast<void>( write( wakeupPipe[1], "", 1 ) >= 0 );
+	}
+#endif
+}
+
 /**
  * Clear the screen ONLY (no redisplay of anything)
  */
@@ -1,21 +1,50 @@
 #ifndef REPLXX_IO_HXX_INCLUDED
 #define REPLXX_IO_HXX_INCLUDED 1
 
+#include <vector>
+
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
 namespace replxx {
 
-int write32( int fd, char32_t* text32, int len32 );
+/*! \brief Output of a single screen update.
+ *
+ * Escape sequences and text for one repaint are collected here
+ * and sent to the terminal with a single write.
+ */
+class OutputBuffer {
+public:
+	typedef std::vector<char> data_t;
+private:
+	data_t _data;
+	long long _written;
+public:
+	OutputBuffer( void );
+	void write8( char const*, int );
+	void write8( char const* );
+	void write32( char32_t const*, int );
+	int flush( void );
+	long long written( void ) const {
+		return ( _written );
+	}
+private:
+	OutputBuffer( OutputBuffer const& ) = delete;
+	OutputBuffer& operator = ( OutputBuffer const& ) = delete;
+};
+
 int getScreenColumns(void);
 int getScreenRows(void);
 void setDisplayAttribute(bool enhancedDisplay, bool);
 int enableRawMode(void);
 void disableRawMode(void);
 char32_t readUnicodeCharacter(void);
+void read_ahead( bool );
 void beep();
-char32_t read_char(void);
+char32_t read_char( bool wakeable = false );
+bool input_pending( int timeoutMs = 0 );
+void wakeup( void );
 enum class CLEAR_SCREEN {
 	WHOLE,
 	TO_END
@@ -49,6 +49,9 @@ static const int END_KEY = 0x10C00000;
 static const int DELETE_KEY = 0x10E00000;
 static const int PAGE_UP_KEY = 0x11000000;
 static const int PAGE_DOWN_KEY = 0x11200000;
+static const int PASTE_START = 0x11400000;	// bracketed paste markers
+static const int PASTE_FINISH = 0x11600000;
+static const int ASYNC_RESULT = 0x11800000;	// results posted by asynchronous callbacks
 
 #endif
 
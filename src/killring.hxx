@@ -2,6 +2,7 @@
 #define REPLXX_KILLRING_HXX_INCLUDED 1
 
 #include <vector>
+#include <utility>
 
 #include "utfstring.hxx"
 
@@ -43,7 +44,7 @@ class KillRing {
 			}
 			temp[resultLen] = 0;
 			temp.initFromBuffer();
-			theRing[slot] = temp;
+			theRing[slot] = std::move( temp );
 		} else {
 			if (size < capacity) {
 				if (size > 0) {
@@ -51,10 +52,10 @@ class KillRing {
 				}
 				indexToSlot[0] = size;
 				size++;
-				theRing.push_back(killedText);
+				theRing.push_back( std::move( killedText ) );
 			} else {
 				int slot = indexToSlot[capacity - 1];
-				theRing[slot] = killedText;
+				theRing[slot] = std::move( killedText );
 				memmove(&indexToSlot[1], &indexToSlot[0], capacity - 1);
 				indexToSlot[0] = slot;
 			}
@@ -0,0 +1,180 @@
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include "palette.hxx"
+
+using namespace std;
+
+namespace replxx {
+
+namespace {
+
+// default xterm values of basic colors
+int const BASIC_RGB[16][3] = {
+	{   0,   0,   0 }, { 205,   0,   0 }, {   0, 205,   0 }, { 205, 205,   0 },
+	{   0,   0, 238 }, { 205,   0, 205 }, {   0, 205, 205 }, { 229, 229, 229 },
+	{ 127, 127, 127 }, { 255,   0,   0 }, {   0, 255,   0 }, { 255, 255,   0 },
+	{  92,  92, 255 }, { 255,   0, 255 }, {   0, 255, 255 }, { 255, 255, 255 }
+};
+
+int cube_level( int value_ ) {
+	return ( value_ < 48 ? 0 : ( value_ < 115 ? 1 : ( value_ - 35 ) / 40 ) );
+}
+
+int cube_value( int level_ ) {
+	return ( level_ > 0 ? 55 + 40 * level_ : 0 );
+}
+
+void indexed_rgb( int index_, int* rgb_ ) {
+	if ( index_ < 16 ) {
+		memcpy( rgb_, BASIC_RGB[index_], sizeof ( BASIC_RGB[index_] ) );
+	} else if ( index_ < 232 ) {
+		index_ -= 16;
+		rgb_[0] = cube_value( index_ / 36 );
+		rgb_[1] = cube_value( ( index_ / 6 ) % 6 );
+		rgb_[2] = cube_value( index_ % 6 );
+	} else {
+		rgb_[0] = rgb_[1] = rgb_[2] = 8 + 10 * ( index_ - 232 );
+	}
+}
+
+int distance( int const* left_, int const* right_ ) {
+	int d( 0 );
+	for ( int i( 0 ); i < 3; ++ i ) {
+		d += ( left_[i] - right_[i] ) * ( left_[i] - right_[i] );
+	}
+	return ( d );
+}
+
+int nearest_basic( int const* rgb_ ) {
+	int best( 0 );
+	for ( int i( 1 ); i < 16; ++ i ) {
+		if ( distance( rgb_, BASIC_RGB[i] ) < distance( rgb_, BASIC_RGB[best] ) ) {
+			best = i;
+		}
+	}
+	return ( best );
+}
+
+int nearest_indexed( int const* rgb_ ) {
+	int cube( 16 + 36 * cube_level( rgb_[0] ) + 6 * cube_level( rgb_[1] ) + cube_level( rgb_[2] ) );
+	int level( ( rgb_[0] + rgb_[1] + rgb_[2] ) / 3 );
+	int gray( level < 8 ? 232 : ( level > 238 ? 255 : 232 + ( level - 8 ) / 10 ) );
+	int cubeRGB[3];
+	int grayRGB[3];
+	indexed_rgb( cube, cubeRGB );
+	indexed_rgb( gray, grayRGB );
+	return ( distance( rgb_, grayRGB ) < distance( rgb_, cubeRGB ) ? gray : cube );
+}
+
+}
+
+Palette::Palette( void )
+	: _depth( DEPTH::BASIC )
+	, _codes()
+	, _codes8()
+	, _starts() {
+	_starts.reserve( CODE_COUNT + 1 );
+	char const* TERM( getenv( "TERM" ) );
+	bool has256color( TERM ? ( strstr( TERM, "256" ) != nullptr ) : false );
+#ifndef _WIN32
+	char const* COLORTERM( getenv( "COLORTERM" ) );
+	if ( COLORTERM && ( ! strcmp( COLORTERM, "truecolor" ) || ! strcmp( COLORTERM, "24bit" ) ) ) {
+		_depth = DEPTH::TRUECOLOR;
+	} else if ( has256color ) {
+		_depth = DEPTH::INDEXED;
+	}
+#endif
+	add_code( "\033[101;1;33m" );
+	add_code( "\033[0m" );
+	char const* basic[] = {
+		"\033[0;22;30m", "\033[0;22;31m", "\033[0;22;32m", "\033[0;22;33m",
+		"\033[0;22;34m", "\033[0;22;35m", "\033[0;22;36m", "\033[0;22;37m"
+	};
+	for ( char const* code : basic ) {
+		add_code( code );
+	}
+	char code[32];
+	for ( int i( 0 ); i < 8; ++ i ) {
+		snprintf( code, sizeof ( code ), "\033[0;1;%dm", ( has256color ? 90 : 30 ) + i );
+		add_code( code );
+	}
+	for ( int i( 16 ); i < 256; ++ i ) {
+		if ( _depth == DEPTH::BASIC ) {
+			int rgb[3];
+			indexed_rgb( i, rgb );
+			int n( nearest_basic( rgb ) + 2 );
+			_starts.push_back( static_cast<int>( _codes.size() ) );
+			_codes.append( _codes, _starts[n], _starts[n + 1] - _starts[n] );
+			_codes8.append( _codes8, _starts[n], _starts[n + 1] - _starts[n] );
+		} else {
+			snprintf( code, sizeof ( code ), "\033[0;22;38;5;%dm", i );
+			add_code( code );
+		}
+	}
+	_starts.push_back( static_cast<int>( _codes.size() ) );
+}
+
+void Palette::add_code( char const* code_ ) {
+	_starts.push_back( static_cast<int>( _codes.size() ) );
+	_codes8.append( code_ );
+	while ( *code_ ) {
+		_codes.push_back( static_cast<char32_t>( *code_ ) );
+		++ code_;
+	}
+}
+
+/*
+ * Index of the code of given color, or -1 if the code
+ * has to be built by rgb_code().
+ */
+int Palette::code_index( Replxx::Color color_ ) const {
+	int value( static_cast<int>( color_ ) );
+	if ( color_ == Replxx::Color::ERROR ) {
+		return ( 0 );
+	} else if ( ( value >= 0 ) && ( value < 256 ) ) {
+		return ( value + 2 );
+	} else if ( ( value & ~0xffffff ) == Palette::RGB_FLAG ) {
+		if ( _depth == DEPTH::TRUECOLOR ) {
+			return ( -1 );
+		}
+		int rgb[] = { ( value >> 16 ) & 0xff, ( value >> 8 ) & 0xff, value & 0xff };
+		return ( nearest_indexed( rgb ) + 2 );
+	}
+	return ( 1 );
+}
+
+int Palette::rgb_code( Replxx::Color color_, char* code_ ) const {
+	int value( static_cast<int>( color_ ) );
+	return (
+		snprintf(
+			code_, 32, "\033[0;22;38;2;%d;%d;%dm",
+			( value >> 16 ) & 0xff, ( value >> 8 ) & 0xff, value & 0xff
+		)
+	);
+}
+
+void Palette::append( display_t& display_, Replxx::Color color_ ) const {
+	int index( code_index( color_ ) );
+	if ( index >= 0 ) {
+		display_.insert( display_.end(), _codes.data() + _starts[index], _codes.data() + _starts[index + 1] );
+	} else {
+		char code[32];
+		int len( rgb_code( color_, code ) );
+		display_.insert( display_.end(), code, code + len );
+	}
+}
+
+void Palette::write( OutputBuffer& out_, Replxx::Color color_ ) const {
+	int index( code_index( color_ ) );
+	if ( index >= 0 ) {
+		out_.write8( _codes8.data() + _starts[index], _starts[index + 1] - _starts[index] );
+	} else {
+		char code[32];
+		out_.write8( code, rgb_code( color_, code ) );
+	}
+}
+
+}
+
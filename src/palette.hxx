@@ -0,0 +1,51 @@
+#ifndef REPLXX_PALETTE_HXX_INCLUDED
+#define REPLXX_PALETTE_HXX_INCLUDED 1
+
+#include <vector>
+#include <string>
+
+#include "replxx.hxx"
+#include "io.hxx"
+
+namespace replxx {
+
+/*! \brief Escape sequences selecting colors.
+ *
+ * Codes of basic colors and of the 256 color palette are built once,
+ * when the Replxx instance is created, both as UTF-32 for the display
+ * buffer and as UTF-8 for direct output, so setting a color is a single
+ * append.  Colors the terminal cannot show are replaced with the nearest
+ * color it can.
+ */
+class Palette {
+public:
+	enum class DEPTH {
+		BASIC,
+		INDEXED,
+		TRUECOLOR
+	};
+	typedef std::vector<char32_t> display_t;
+	static int const RGB_FLAG = 0x1000000; // marks Replxx::Color given as 0xRRGGBB
+private:
+	static int const CODE_COUNT = 258;  // ERROR, DEFAULT and 256 indexed colors
+	DEPTH _depth;
+	std::u32string _codes;              // all codes back to back
+	std::string _codes8;                // same as _codes, in UTF-8
+	std::vector<int> _starts;           // offset of each code, CODE_COUNT + 1 entries
+public:
+	Palette( void );
+	DEPTH depth( void ) const {
+		return ( _depth );
+	}
+	void append( display_t& display_, Replxx::Color color_ ) const;
+	void write( OutputBuffer& out_, Replxx::Color color_ ) const;
+private:
+	int code_index( Replxx::Color ) const;
+	int rgb_code( Replxx::Color, char* ) const;
+	void add_code( char const* );
+};
+
+}
+
+#endif
+
@@ -0,0 +1,194 @@
+#include <algorithm>
+
+#include "prefixtree.hxx"
+
+using namespace std;
+
+namespace replxx {
+
+namespace {
+
+int common_length( string const& label_, string const& text_, size_t pos_ ) {
+	size_t len( min( label_.length(), text_.length() - pos_ ) );
+	size_t i( 0 );
+	while ( ( i < len ) && ( label_[i] == text_[pos_ + i] ) ) {
+		++ i;
+	}
+	return ( static_cast<int>( i ) );
+}
+
+typedef vector<unique_ptr<PrefixTree::Node>> children_t;
+
+children_t::iterator find_child( children_t& children_, char c_ ) {
+	return (
+		find_if( children_.begin(), children_.end(), [c_]( unique_ptr<PrefixTree::Node> const& n ) { return ( n->label[0] == c_ ); } )
+	);
+}
+
+/*
+ * Find first element of `a` not present in `b`, `b` being a subset of `a`,
+ * both ordered by `at()` of given sequence, in O(log n).
+ * Elements common to both form a common beginning of them, past the first
+ * element of `a` missing from `b` no element of `a` matches `b` at the same
+ * index, so its index is found with a binary search.
+ */
+template<typename at_t>
+int first_missing( int aCount_, int bCount_, at_t at_ ) {
+	int lo( 0 );
+	int hi( min( aCount_, bCount_ ) );
+	while ( lo < hi ) {
+		int mid( lo + ( hi - lo ) / 2 );
+		if ( at_( true, mid ) == at_( false, mid ) ) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return ( lo < aCount_ ? at_( true, lo ) : -1 );
+}
+
+}
+
+void PrefixTree::Serials::pop_front( void ) {
+	++ start;
+	// drop removed serials once they make up half of the list
+	if ( ( start * 2 ) >= static_cast<int>( serials.size() ) ) {
+		serials.erase( serials.begin(), serials.begin() + start );
+		start = 0;
+	}
+}
+
+/*
+ * Add a line newer than any line in the tree.
+ * Splitting an edge copies serials of the node below the split,
+ * this happens once for each new branching point.
+ */
+void PrefixTree::insert( std::string const& line_, int serial_ ) {
+	Node* node( &_root );
+	size_t pos( 0 );
+	while ( true ) {
+		node->lines.serials.push_back( serial_ );
+		if ( pos == line_.length() ) {
+			node->ends.serials.push_back( serial_ );
+			break;
+		}
+		children_t::iterator it( find_child( node->children, line_[pos] ) );
+		if ( it == node->children.end() ) {
+			node->children.emplace_back( new Node( line_.substr( pos ) ) );
+			node = node->children.back().get();
+			pos = line_.length();
+			continue;
+		}
+		int common( common_length( ( *it )->label, line_, pos ) );
+		if ( common < static_cast<int>( ( *it )->label.length() ) ) {
+			unique_ptr<Node> split( new Node( ( *it )->label.substr( 0, common ) ) );
+			split->lines.serials.assign( ( *it )->lines.begin(), ( *it )->lines.end() );
+			( *it )->label.erase( 0, common );
+			split->children.push_back( move( *it ) );
+			*it = move( split );
+		}
+		node = it->get();
+		pos += common;
+	}
+}
+
+/*
+ * Remove the oldest ( oldest_ == true ) or the newest line,
+ * nodes left without lines are removed too.
+ */
+void PrefixTree::erase( std::string const& line_, bool oldest_ ) {
+	Node* node( &_root );
+	size_t pos( 0 );
+	while ( true ) {
+		Serials& lines( node->lines );
+		if ( oldest_ ) {
+			lines.pop_front();
+		} else {
+			lines.serials.pop_back();
+		}
+		if ( pos == line_.length() ) {
+			if ( oldest_ ) {
+				node->ends.pop_front();
+			} else {
+				node->ends.serials.pop_back();
+			}
+			break;
+		}
+		children_t::iterator it( find_child( node->children, line_[pos] ) );
+		if ( ( *it )->lines.start + 1 == static_cast<int>( ( *it )->lines.serials.size() ) ) {
+			// the line is the only one left below
+			node->children.erase( it );
+			break;
+		}
+		pos += ( *it )->label.length();
+		node = it->get();
+	}
+}
+
+/*
+ * Find node of lines starting with given text,
+ * or, if exact_ is set, the node of the text itself.
+ */
+PrefixTree::Node const* PrefixTree::find( std::string const& text_, bool exact_ ) const {
+	Node const* node( &_root );
+	size_t pos( 0 );
+	while ( pos < text_.length() ) {
+		Node const* child( nullptr );
+		for ( unique_ptr<Node> const& n : node->children ) {
+			if ( n->label[0] == text_[pos] ) {
+				child = n.get();
+				break;
+			}
+		}
+		if ( ! child ) {
+			return ( nullptr );
+		}
+		int common( common_length( child->label, text_, pos ) );
+		pos += common;
+		if ( common < static_cast<int>( child->label.length() ) ) {
+			return ( ( ! exact_ && ( pos == text_.length() ) ) ? child : nullptr );
+		}
+		node = child;
+	}
+	return ( node );
+}
+
+/*
+ * Find serial nearest to given one, following it ( back_ == false )
+ * or preceding it, among lines starting with prefix_ other than lines
+ * equal to line_, which starts with prefix_ too.
+ * Returns -1 if there is no such line.
+ */
+int PrefixTree::nearest( std::string const& prefix_, std::string const& line_, int serial_, bool back_ ) const {
+	Node const* node( find( prefix_, false ) );
+	if ( ! node ) {
+		return ( -1 );
+	}
+	static Serials const none;
+	Node const* same( find( line_, true ) );
+	Serials const& skipped( same ? same->ends : none );
+	int const* a( node->lines.begin() );
+	int const* b( skipped.begin() );
+	if ( back_ ) {
+		// both sequences are walked backwards from the last serial before serial_
+		int const* aEnd( lower_bound( a, node->lines.end(), serial_ ) );
+		int const* bEnd( lower_bound( b, skipped.end(), serial_ ) );
+		return (
+			first_missing(
+				static_cast<int>( aEnd - a ), static_cast<int>( bEnd - b ),
+				[aEnd, bEnd]( bool inA_, int i_ ) { return ( inA_ ? aEnd[-1 - i_] : bEnd[-1 - i_] ); }
+			)
+		);
+	}
+	int const* aStart( upper_bound( a, node->lines.end(), serial_ ) );
+	int const* bStart( upper_bound( b, skipped.end(), serial_ ) );
+	return (
+		first_missing(
+			static_cast<int>( node->lines.end() - aStart ), static_cast<int>( skipped.end() - bStart ),
+			[aStart, bStart]( bool inA_, int i_ ) { return ( inA_ ? aStart[i_] : bStart[i_] ); }
+		)
+	);
+}
+
+}
+
@@ -0,0 +1,74 @@
+#ifndef REPLXX_PREFIXTREE_HXX_INCLUDED
+#define REPLXX_PREFIXTREE_HXX_INCLUDED 1
+
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace replxx {
+
+/*! \brief Radix tree of history lines for common prefix search.
+ *
+ * Lines are identified by serial numbers, given in increasing order
+ * of addition, and only the oldest or the newest line is removed.
+ * Each node keeps sorted serials of all lines starting with its text,
+ * so a line is added by appending its serial to nodes on its path
+ * and removed by dropping it from either end of their lists,
+ * in time linear in length of the line and independent of history size.
+ *
+ * Serial nearest to given one among lines starting with a prefix
+ * is found with a binary search in the node of the prefix.
+ */
+class PrefixTree {
+public:
+	/*! \brief Sorted serial numbers, those before `start` are removed already.
+	 */
+	struct Serials {
+		std::vector<int> serials;
+		int start;
+		Serials( void )
+			: serials()
+			, start( 0 ) {
+		}
+		int const* begin( void ) const {
+			return ( serials.data() + start );
+		}
+		int const* end( void ) const {
+			return ( serials.data() + serials.size() );
+		}
+		bool empty( void ) const {
+			return ( start == static_cast<int>( serials.size() ) );
+		}
+		void pop_front( void );
+	};
+	struct Node {
+		std::string label;   // text of the edge from parent
+		std::vector<std::unique_ptr<Node>> children;
+		Serials lines;       // lines starting with text of this node
+		Serials ends;        // lines equal to text of this node
+		Node( std::string const& label_ )
+			: label( label_ )
+			, children()
+			, lines()
+			, ends() {
+		}
+	};
+private:
+	Node _root;
+public:
+	PrefixTree( void )
+		: _root( std::string() ) {
+	}
+	void insert( std::string const&, int );
+	void erase( std::string const&, bool );
+	int nearest( std::string const&, std::string const&, int, bool ) const;
+private:
+	Node const* find( std::string const&, bool ) const;
+	PrefixTree( PrefixTree const& ) = delete;
+	PrefixTree& operator = ( PrefixTree const& ) = delete;
+};
+
+}
+
+#endif
+
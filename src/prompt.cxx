@@ -23,10 +23,8 @@
 
 namespace replxx {
 
-bool PromptBase::write() {
-	if (write32(1, promptText.get(), promptBytes) == -1) return false;
-
-	return true;
+void PromptBase::write( OutputBuffer& out_ ) {
+	out_.write32( promptText.get(), promptBytes );
 }
 
 PromptInfo::PromptInfo(std::string const& text_, int columns) {
@@ -98,7 +96,7 @@ PromptInfo::PromptInfo(std::string const& text_, int columns) {
 	*pOut = 0;
 	promptChars = len;
 	promptBytes = static_cast<int>(pOut - tempUnicode.get());
-	promptText = tempUnicode;
+	promptText = std::move( tempUnicode );
 
 	promptIndentation = len - promptLastLinePosition;
 	promptCursorRowOffset = promptExtraLines;
@@ -115,8 +113,7 @@ DynamicPrompt::DynamicPrompt(PromptBase& pi, int initialDirection)
 		: searchTextLen(0), direction(initialDirection) {
 	promptScreenColumns = pi.promptScreenColumns;
 	promptCursorRowOffset = 0;
-	Utf32String emptyString(1);
-	searchText = emptyString;
+	searchText = Utf32String( 1 );
 	const Utf32String* basePrompt =
 			(direction > 0) ? &forwardSearchBasePrompt : &reverseSearchBasePrompt;
 	size_t promptStartLength = basePrompt->length();
@@ -133,7 +130,7 @@ DynamicPrompt::DynamicPrompt(PromptBase& pi, int initialDirection)
 	memcpy(&tempUnicode[promptStartLength], endSearchBasePrompt.get(),
 				 sizeof(char32_t) * (endSearchBasePrompt.length() + 1));
 	tempUnicode.initFromBuffer();
-	promptText = tempUnicode;
+	promptText = std::move( tempUnicode );
 	calculateScreenPosition(0, 0, pi.promptScreenColumns, promptChars,
 													promptIndentation, promptExtraLines);
 }
@@ -154,13 +151,13 @@ void DynamicPrompt::updateSearchPrompt(void) {
 	memcpy(&tempUnicode[endIndex], endSearchBasePrompt.get(),
 				 sizeof(char32_t) * (endSearchBasePrompt.length() + 1));
 	tempUnicode.initFromBuffer();
-	promptText = tempUnicode;
+	promptText = std::move( tempUnicode );
 }
 
 void DynamicPrompt::updateSearchText(const char32_t* text_) {
 	Utf32String tempUnicode(text_);
 	searchTextLen = static_cast<int>(tempUnicode.chars());
-	searchText = tempUnicode;
+	searchText = std::move( tempUnicode );
 	updateSearchPrompt();
 }
 
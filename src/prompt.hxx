@@ -6,6 +6,9 @@
 #include "utfstring.hxx"
 
 namespace replxx {
+
+class OutputBuffer;
+
 struct PromptBase {						// a convenience struct for grouping prompt info
 	Utf32String promptText;			// our copy of the prompt text, edited
 	char* promptCharWidths;			// character widths from mk_wcwidth()
@@ -24,7 +27,7 @@ struct PromptBase {						// a convenience struct for grouping prompt info
 
 	PromptBase() : promptPreviousInputLen(0) {}
 
-	bool write();
+	void write( OutputBuffer& );
 };
 
 struct PromptInfo : public PromptBase {
@@ -142,9 +142,9 @@ bool gotResize = false;
 
 namespace {
 
-static int const REPLXX_MAX_LINE( 4096 );
 static int const REPLXX_MAX_HINT_ROWS( 4 );
 char const defaultBreakChars[] = " =+-/\\*?\"'`&<>;|@{([])}";
+char const defaultQuoteChars[] = "\"'";
 
 #ifndef _WIN32
 
@@ -155,6 +155,26 @@ static void WindowSizeChanged(int) {
 
 #endif
 
+/* Read whole line from stdin, whatever its length, false on end of input. */
+static bool read_line( std::string& line_ ) {
+	line_.clear();
+	char chunk[4096];
+	bool got( false );
+	while ( true ) {
+		memset( chunk, 0, sizeof ( chunk ) );
+		if ( fgets( chunk, sizeof ( chunk ), stdin ) == nullptr ) {
+			break;
+		}
+		got = true;
+		line_.append( chunk );
+		// line may hold NULs so the newline is looked for in the whole chunk
+		if ( memchr( chunk, '\n', sizeof ( chunk ) ) != nullptr ) {
+			break;
+		}
+	}
+	return ( got );
+}
+
 static const char* unsupported_term[] = {"dumb", "cons25", "emacs", NULL};
 
 static bool isUnsupportedTerm(void) {
@@ -173,12 +193,14 @@ static bool isUnsupportedTerm(void) {
 }
 
 Replxx::ReplxxImpl::ReplxxImpl( FILE*, FILE*, FILE* )
-	: _maxLineLength( REPLXX_MAX_LINE )
-	, _inputBuffer( new char[_maxLineLength * sizeof ( char32_t ) + 1] )
+	: _maxLineLength( 0 )
+	, _inputBuffer()
 	, _history()
 	, _maxHintRows( REPLXX_MAX_HINT_ROWS )
+	, _hintDelay( 0 )
 	, _breakChars( defaultBreakChars )
 	, _specialPrefixes( "" )
+	, _quoteChars( defaultQuoteChars )
 	, _completionCountCutoff( 100 )
 	, _doubleTabCompletion( false )
 	, _completeOnEmpty( true )
@@ -186,12 +208,38 @@ Replxx::ReplxxImpl::ReplxxImpl( FILE*, FILE*, FILE* )
 	, _noColor( false )
 	, _completionCallback( nullptr )
 	, _highlighterCallback( nullptr )
+	, _incrementalHighlighterCallback( nullptr )
 	, _hintCallback( nullptr )
+	, _asyncCompletionCallback( nullptr )
+	, _asyncHintCallback( nullptr )
 	, _completionUserdata( nullptr )
 	, _highlighterUserdata( nullptr )
+	, _incrementalHighlighterUserdata( nullptr )
 	, _hintUserdata( nullptr )
+	, _asyncCompletionUserdata( nullptr )
+	, _asyncHintUserdata( nullptr )
+	, _asyncMutex()
+	, _lastRequestId( 0 )
+	, _completionRequestId( 0 )
+	, _completionsPosted( false )
+	, _postedCompletions()
+	, _hintRequestId( 0 )
+	, _hintInput()
+	, _hintsPosted( false )
+	, _postedHints()
+	, _postedHintColor( Replxx::Color::GRAY )
+	, _completions()
+	, _hints()
+	, _words()
 	, _preloadedBuffer()
-	, _errorMessage() {
+	, _errorMessage()
+	, _keystrokeCount( 0 )
+	, _output()
+	, _palette()
+	, _editor() {
+}
+
+Replxx::ReplxxImpl::~ReplxxImpl( void ) {
 }
 
 void Replxx::ReplxxImpl::history_add( std::string const& line ) {
@@ -206,44 +254,183 @@ int Replxx::ReplxxImpl::history_load( std::string const& filename ) {
 	return ( _history.load( filename ) );
 }
 
+int Replxx::ReplxxImpl::history_sync( std::string const& filename ) {
+	return ( _history.sync( filename ) );
+}
+
 int Replxx::ReplxxImpl::history_size( void ) const {
 	return ( _history.size() );
 }
 
-Replxx::ReplxxImpl::completions_t Replxx::ReplxxImpl::call_completer( std::string const& input, int breakPos ) const {
-	Replxx::completions_t completionsIntermediary(
-		!! _completionCallback
-			? _completionCallback( input, breakPos, _completionUserdata )
-			: Replxx::completions_t()
-	);
-	completions_t completions;
-	completions.reserve( completionsIntermediary.size() );
-	for ( std::string const& c : completionsIntermediary ) {
-		completions.emplace_back( c.c_str() );
+void Replxx::ReplxxImpl::call_completer( Replxx::InputView const& input, int breakPos ) {
+	_completions.clear();
+	if ( !! _completionCallback ) {
+		_completionCallback( input, breakPos, _completions, _completionUserdata );
 	}
-	return ( completions );
+	add_words( input, breakPos, _completions, false );
 }
 
-Replxx::ReplxxImpl::hints_t Replxx::ReplxxImpl::call_hinter( std::string const& input, int breakPos, Replxx::Color& color ) const {
-	Replxx::hints_t hintsIntermediary(
-		!! _hintCallback
-			? _hintCallback( input, breakPos, color, _hintUserdata )
-			: Replxx::hints_t()
-	);
-	hints_t hints;
-	hints.reserve( hintsIntermediary.size() );
-	for ( std::string const& h : hintsIntermediary ) {
-		hints.emplace_back( h.c_str() );
+Replxx::Collector const& Replxx::ReplxxImpl::call_hinter( Replxx::InputView const& input, int breakPos, Replxx::Color& color ) {
+	_hints.clear();
+	if ( !! _hintCallback ) {
+		_hintCallback( input, breakPos, _hints, color, _hintUserdata );
+	}
+	add_words( input, breakPos, _hints, true );
+	return ( _hints );
+}
+
+/*
+ * Add words from the dictionary starting with the text from breakPos
+ * to the end of input, whole as completions, their remaining parts as hints.
+ */
+void Replxx::ReplxxImpl::add_words( Replxx::InputView const& input, int breakPos, Replxx::Collector& results, bool hints ) {
+	if ( _words.count() == 0 ) {
+		return;
+	}
+	int offset( char_offset8( input.data(), input.size(), breakPos ) );
+	int prefixSize( input.size() - offset );
+	if ( hints && ( prefixSize == 0 ) ) {
+		return;
+	}
+	int first( 0 );
+	int last( 0 );
+	_words.find( input.data() + offset, prefixSize, first, last );
+	if ( hints ) {
+		last = min( last, first + _completionCountCutoff );
+	}
+	int skip( hints ? prefixSize : 0 );
+	for ( int i( first ); i < last; ++ i ) {
+		results.add( _words.get( i ) + skip, _words.size( i ) - skip );
 	}
-	return ( hints );
 }
 
-void Replxx::ReplxxImpl::call_highlighter( std::string const& input, Replxx::colors_t& colors ) const {
+void Replxx::ReplxxImpl::call_highlighter( Replxx::InputView const& input, Replxx::colors_t& colors ) const {
 	if ( !! _highlighterCallback ) {
 		_highlighterCallback( input, colors, _highlighterUserdata );
 	}
 }
 
+void Replxx::ReplxxImpl::call_incremental_highlighter(
+	Replxx::InputView const& input, int pos, int removed, int inserted, Replxx::colors_t& colors
+) const {
+	if ( !! _incrementalHighlighterCallback ) {
+		_incrementalHighlighterCallback( input, pos, removed, inserted, colors, _incrementalHighlighterUserdata );
+	}
+}
+
+/*
+ * Asynchronous requests.
+ *
+ * Each request gets a new identifier, a newer request or a cancellation
+ * makes older identifiers stale and results posted for them are dropped.
+ * Results are handed over under _asyncMutex and wakeup() makes
+ * the input loop repaint with them.
+ */
+
+void Replxx::ReplxxImpl::request_completions( Replxx::InputView const& input, int breakPos ) {
+	int requestId( 0 );
+	{
+		std::lock_guard<std::mutex> l( _asyncMutex );
+		requestId = ++ _lastRequestId;
+		_completionRequestId = requestId;
+		_completionsPosted = false;
+		_postedCompletions.clear();
+	}
+	_asyncCompletionCallback( input.str(), breakPos, requestId, _asyncCompletionUserdata );
+}
+
+bool Replxx::ReplxxImpl::posted_completions( void ) {
+	std::lock_guard<std::mutex> l( _asyncMutex );
+	if ( ! _completionsPosted ) {
+		return ( false );
+	}
+	_completions.swap( _postedCompletions );
+	_postedCompletions.clear();
+	_completionsPosted = false;
+	_completionRequestId = 0;
+	return ( true );
+}
+
+void Replxx::ReplxxImpl::cancel_completions( void ) {
+	std::lock_guard<std::mutex> l( _asyncMutex );
+	_completionRequestId = 0;
+	_completionsPosted = false;
+	_postedCompletions.clear();
+}
+
+void Replxx::ReplxxImpl::post_completions( int requestId, Replxx::completions_t const& completionsIntermediary ) {
+	Replxx::Collector completions;
+	for ( std::string const& c : completionsIntermediary ) {
+		completions.add( c );
+	}
+	{
+		std::lock_guard<std::mutex> l( _asyncMutex );
+		if ( ( requestId == 0 ) || ( requestId != _completionRequestId ) ) {
+			return;
+		}
+		_postedCompletions.swap( completions );
+		_completionsPosted = true;
+	}
+	wakeup();
+}
+
+void Replxx::ReplxxImpl::request_hints( Replxx::InputView const& input, int breakPos ) {
+	int requestId( 0 );
+	{
+		std::lock_guard<std::mutex> l( _asyncMutex );
+		if ( ( _hintRequestId != 0 ) && ( _hintInput.compare( 0, std::string::npos, input.data(), input.size() ) == 0 ) ) {
+			return; // already asked for this input
+		}
+		requestId = ++ _lastRequestId;
+		_hintRequestId = requestId;
+		_hintInput.assign( input.data(), input.size() );
+		_hintsPosted = false;
+		_postedHints.clear();
+	}
+	_asyncHintCallback( input.str(), breakPos, requestId, _asyncHintUserdata );
+}
+
+Replxx::Collector const& Replxx::ReplxxImpl::posted_hints( Replxx::Color& color ) {
+	std::lock_guard<std::mutex> l( _asyncMutex );
+	if ( _hintsPosted ) {
+		_hints = _postedHints;
+		color = _postedHintColor;
+	} else {
+		_hints.clear();
+	}
+	return ( _hints );
+}
+
+void Replxx::ReplxxImpl::cancel_hints( void ) {
+	std::lock_guard<std::mutex> l( _asyncMutex );
+	_hintRequestId = 0;
+	_hintInput.clear();
+	_hintsPosted = false;
+	_postedHints.clear();
+}
+
+void Replxx::ReplxxImpl::post_hints( int requestId, Replxx::hints_t const& hintsIntermediary, Replxx::Color color ) {
+	Replxx::Collector hints;
+	for ( std::string const& h : hintsIntermediary ) {
+		hints.add( h );
+	}
+	{
+		std::lock_guard<std::mutex> l( _asyncMutex );
+		if ( ( requestId == 0 ) || ( requestId != _hintRequestId ) ) {
+			return;
+		}
+		_postedHints.swap( hints );
+		_postedHintColor = color;
+		_hintsPosted = true;
+	}
+	wakeup();
+}
+
+bool Replxx::ReplxxImpl::is_request_current( int requestId ) const {
+	std::lock_guard<std::mutex> l( _asyncMutex );
+	return ( ( requestId != 0 ) && ( ( requestId == _completionRequestId ) || ( requestId == _hintRequestId ) ) );
+}
+
 void Replxx::ReplxxImpl::set_preload_buffer( std::string const& preloadText ) {
 	_preloadedBuffer = preloadText;
 	// remove characters that won't display correctly
@@ -278,10 +465,10 @@ void Replxx::ReplxxImpl::set_preload_buffer( std::string const& preloadText ) {
 		++ it;
 	}
 	bool lineTruncated = false;
-	int processedLength( static_cast<int>( _preloadedBuffer.length() ) );
-	if ( processedLength > ( _maxLineLength - 1 ) ) {
+	int processedLength( strlen8( _preloadedBuffer.data(), static_cast<int>( _preloadedBuffer.length() ) ) );
+	if ( ( _maxLineLength > 0 ) && ( processedLength > _maxLineLength ) ) {
 		lineTruncated = true;
-		_preloadedBuffer.erase( _maxLineLength );
+		_preloadedBuffer.erase( char_offset8( _preloadedBuffer.data(), static_cast<int>( _preloadedBuffer.length() ), _maxLineLength ) );
 	}
 	_errorMessage.clear();
 	if ( controlsStripped ) {
@@ -292,7 +479,7 @@ void Replxx::ReplxxImpl::set_preload_buffer( std::string const& preloadText ) {
 			.append( " [Edited line: the line length was reduced from " )
 			.append( to_string( processedLength ) )
 			.append( " to " )
-			.append( to_string( _preloadedBuffer.length() ) )
+			.append( to_string( _maxLineLength ) )
 			.append( "]\n" );
 	}
 }
@@ -309,55 +496,56 @@ char const* Replxx::ReplxxImpl::input( std::string const& prompt ) {
 		}
 		PromptInfo pi(prompt, getScreenColumns());
 		if (isUnsupportedTerm()) {
-			if (!pi.write()) return 0;
-			fflush(stdout);
+			pi.write( _output );
+			if ( _output.flush() == -1 ) return 0;
 			if (_preloadedBuffer.empty()) {
-				if (fgets(_inputBuffer.get(), _maxLineLength, stdin) == NULL) {
+				if ( ! read_line( _inputBuffer ) ) {
 					return NULL;
 				}
-				size_t len = strlen(_inputBuffer.get());
-				while (len && (_inputBuffer[len - 1] == '\n' || _inputBuffer[len - 1] == '\r')) {
-					--len;
-					_inputBuffer[len] = '\0';
+				while ( ! _inputBuffer.empty() && ( ( _inputBuffer.back() == '\n' ) || ( _inputBuffer.back() == '\r' ) ) ) {
+					_inputBuffer.pop_back();
 				}
-				return ( _inputBuffer.get() );
+				return ( _inputBuffer.c_str() );
 			} else {
-				strncpy( _inputBuffer.get(), _preloadedBuffer.c_str(), _maxLineLength );
+				_inputBuffer.swap( _preloadedBuffer );
 				_preloadedBuffer.clear();
-				return ( _inputBuffer.get() );
+				return ( _inputBuffer.c_str() );
 			}
 		} else {
 			if (enableRawMode() == -1) {
 				return NULL;
 			}
-			InputBuffer ib(*this, _maxLineLength);
+			if ( ! _editor ) {
+				_editor.reset( new InputBuffer( *this, _maxLineLength ) );
+			} else {
+				_editor->reset( _maxLineLength );
+			}
+			InputBuffer& ib( *_editor );
 			if (!_preloadedBuffer.empty()) {
 				ib.preloadBuffer(_preloadedBuffer.c_str());
 				_preloadedBuffer.clear();
 			}
 			int count = ib.getInputLine(pi);
+			cancel_completions();
+			cancel_hints();
 			disableRawMode();
 			if (count == -1) {
 				return NULL;
 			}
-			assert( ib.length() < _maxLineLength );
 			printf("\n");
-			size_t bufferSize = sizeof(char32_t) * ib.length() + 1;
-			copyString32to8(_inputBuffer.get(), bufferSize, ib.buf());
-			return ( _inputBuffer.get() );
+			// UTF-8 copy of the line was kept up to date while it was edited
+			return ( ib.utf8() );
 		}
 	} else { // input not from a terminal, we should work with piped input, i.e. redirected stdin
-		if (fgets(_inputBuffer.get(), _maxLineLength, stdin) == NULL) {
+		if ( ! read_line( _inputBuffer ) ) {
 			return NULL;
 		}
 
 		// if fgets() gave us the newline, remove it
-		int count = static_cast<int>( strlen( _inputBuffer.get() ) );
-		if (count > 0 && _inputBuffer[count - 1] == '\n') {
-			--count;
-			_inputBuffer[count] = '\0';
+		if ( ! _inputBuffer.empty() && ( _inputBuffer.back() == '\n' ) ) {
+			_inputBuffer.pop_back();
 		}
-		return ( _inputBuffer.get() );
+		return ( _inputBuffer.c_str() );
 	}
 }
 
@@ -383,35 +571,139 @@ std::string const& Replxx::ReplxxImpl::history_line( int index ) {
 }
 
 void Replxx::ReplxxImpl::set_completion_callback( Replxx::completion_callback_t const& fn, void* userData ) {
+	Replxx::completion_view_callback_t viewFn;
+	if ( !! fn ) {
+		viewFn = [fn]( Replxx::InputView const& input, int breakPos, void* ud ) {
+			return ( fn( input.str(), breakPos, ud ) );
+		};
+	}
+	set_completion_view_callback( viewFn, userData );
+}
+
+void Replxx::ReplxxImpl::set_completion_view_callback( Replxx::completion_view_callback_t const& fn, void* userData ) {
+	Replxx::completion_collector_callback_t collectorFn;
+	if ( !! fn ) {
+		collectorFn = [fn]( Replxx::InputView const& input, int breakPos, Replxx::Collector& completions, void* ud ) {
+			for ( std::string const& c : fn( input, breakPos, ud ) ) {
+				completions.add( c );
+			}
+		};
+	}
+	set_completion_collector_callback( collectorFn, userData );
+}
+
+void Replxx::ReplxxImpl::set_completion_collector_callback( Replxx::completion_collector_callback_t const& fn, void* userData ) {
 	_completionCallback = fn;
 	_completionUserdata = userData;
 }
 
+void Replxx::ReplxxImpl::set_completion_words( Replxx::completions_t const& words ) {
+	_words.clear();
+	add_completion_words( words );
+}
+
+void Replxx::ReplxxImpl::set_completion_words( char const** words, int count ) {
+	_words.clear();
+	add_completion_words( words, count );
+}
+
+void Replxx::ReplxxImpl::add_completion_words( Replxx::completions_t const& words ) {
+	for ( std::string const& w : words ) {
+		_words.add( w.data(), static_cast<int>( w.size() ) );
+	}
+	_words.sort();
+}
+
+void Replxx::ReplxxImpl::add_completion_words( char const** words, int count ) {
+	for ( int i( 0 ); i < count; ++ i ) {
+		_words.add( words[i], static_cast<int>( strlen( words[i] ) ) );
+	}
+	_words.sort();
+}
+
 void Replxx::ReplxxImpl::set_highlighter_callback( Replxx::highlighter_callback_t const& fn, void* userData ) {
+	Replxx::highlighter_view_callback_t viewFn;
+	if ( !! fn ) {
+		viewFn = [fn]( Replxx::InputView const& input, Replxx::colors_t& colors, void* ud ) {
+			fn( input.str(), colors, ud );
+		};
+	}
+	set_highlighter_view_callback( viewFn, userData );
+}
+
+void Replxx::ReplxxImpl::set_highlighter_view_callback( Replxx::highlighter_view_callback_t const& fn, void* userData ) {
 	_highlighterCallback = fn;
 	_highlighterUserdata = userData;
 }
 
+void Replxx::ReplxxImpl::set_incremental_highlighter_callback( Replxx::incremental_highlighter_callback_t const& fn, void* userData ) {
+	Replxx::incremental_highlighter_view_callback_t viewFn;
+	if ( !! fn ) {
+		viewFn = [fn]( Replxx::InputView const& input, int pos, int removed, int inserted, Replxx::colors_t& colors, void* ud ) {
+			fn( input.str(), pos, removed, inserted, colors, ud );
+		};
+	}
+	set_incremental_highlighter_view_callback( viewFn, userData );
+}
+
+void Replxx::ReplxxImpl::set_incremental_highlighter_view_callback( Replxx::incremental_highlighter_view_callback_t const& fn, void* userData ) {
+	_incrementalHighlighterCallback = fn;
+	_incrementalHighlighterUserdata = userData;
+}
+
 void Replxx::ReplxxImpl::set_hint_callback( Replxx::hint_callback_t const& fn, void* userData ) {
+	Replxx::hint_view_callback_t viewFn;
+	if ( !! fn ) {
+		viewFn = [fn]( Replxx::InputView const& input, int breakPos, Replxx::Color& color, void* ud ) {
+			return ( fn( input.str(), breakPos, color, ud ) );
+		};
+	}
+	set_hint_view_callback( viewFn, userData );
+}
+
+void Replxx::ReplxxImpl::set_hint_view_callback( Replxx::hint_view_callback_t const& fn, void* userData ) {
+	Replxx::hint_collector_callback_t collectorFn;
+	if ( !! fn ) {
+		collectorFn = [fn]( Replxx::InputView const& input, int breakPos, Replxx::Collector& hints, Replxx::Color& color, void* ud ) {
+			for ( std::string const& h : fn( input, breakPos, color, ud ) ) {
+				hints.add( h );
+			}
+		};
+	}
+	set_hint_collector_callback( collectorFn, userData );
+}
+
+void Replxx::ReplxxImpl::set_hint_collector_callback( Replxx::hint_collector_callback_t const& fn, void* userData ) {
 	_hintCallback = fn;
 	_hintUserdata = userData;
 }
 
+void Replxx::ReplxxImpl::set_async_completion_callback( Replxx::async_completion_callback_t const& fn, void* userData ) {
+	_asyncCompletionCallback = fn;
+	_asyncCompletionUserdata = userData;
+}
+
+void Replxx::ReplxxImpl::set_async_hint_callback( Replxx::async_hint_callback_t const& fn, void* userData ) {
+	_asyncHintCallback = fn;
+	_asyncHintUserdata = userData;
+}
+
 void Replxx::ReplxxImpl::set_max_history_size( int len ) {
 	_history.set_max_size( len );
 }
 
 void Replxx::ReplxxImpl::set_max_line_size( int len ) {
-	if ( len > _maxLineLength ) {
-		_inputBuffer.reset( new char[len * sizeof ( char32_t ) + 1] );
-	}
-	_maxLineLength = len;
+	_maxLineLength = max( len, 0 );
 }
 
 void Replxx::ReplxxImpl::set_max_hint_rows( int count ) {
 	_maxHintRows = count;
 }
 
+void Replxx::ReplxxImpl::set_hint_delay( int milliseconds ) {
+	_hintDelay = milliseconds;
+}
+
 void Replxx::ReplxxImpl::set_word_break_characters( char const* wordBreakers ) {
 	_breakChars = wordBreakers;
 }
@@ -420,6 +712,18 @@ void Replxx::ReplxxImpl::set_special_prefixes( char const* specialPrefixes ) {
 	_specialPrefixes = specialPrefixes;
 }
 
+void Replxx::ReplxxImpl::set_quote_characters( char const* quoteChars ) {
+	_quoteChars = quoteChars;
+}
+
+int Replxx::ReplxxImpl::matching_bracket( int pos ) {
+	return ( _editor ? _editor->matching_bracket( pos ) : -1 );
+}
+
+bool Replxx::ReplxxImpl::is_quoted( int pos ) {
+	return ( _editor ? _editor->is_quoted( pos ) : false );
+}
+
 void Replxx::ReplxxImpl::set_double_tab_completion( bool val ) {
 	_doubleTabCompletion = val;
 }
@@ -445,6 +749,11 @@ int Replxx::ReplxxImpl::print( char const* str_, int size_ ) {
 	return ( count );
 }
 
+void Replxx::ReplxxImpl::output_stats( long long& keystrokes_, long long& bytes_ ) const {
+	keystrokes_ = _keystrokeCount;
+	bytes_ = _output.written();
+}
+
 namespace {
 void delete_ReplxxImpl( Replxx::ReplxxImpl* impl_ ) {
 	delete impl_;
@@ -459,6 +768,22 @@ void Replxx::set_completion_callback( completion_callback_t const& fn, void* use
 	_impl->set_completion_callback( fn, userData );
 }
 
+void Replxx::set_completion_view_callback( completion_view_callback_t const& fn, void* userData ) {
+	_impl->set_completion_view_callback( fn, userData );
+}
+
+void Replxx::set_completion_collector_callback( completion_collector_callback_t const& fn, void* userData ) {
+	_impl->set_completion_collector_callback( fn, userData );
+}
+
+void Replxx::set_completion_words( completions_t const& words ) {
+	_impl->set_completion_words( words );
+}
+
+void Replxx::add_completion_words( completions_t const& words ) {
+	_impl->add_completion_words( words );
+}
+
 #if 0
 int Replxx::print( char const* fmt, ... );
 #endif
@@ -467,10 +792,69 @@ void Replxx::set_highlighter_callback( highlighter_callback_t const& fn, void* u
 	_impl->set_highlighter_callback( fn, userData );
 }
 
+void Replxx::set_highlighter_view_callback( highlighter_view_callback_t const& fn, void* userData ) {
+	_impl->set_highlighter_view_callback( fn, userData );
+}
+
+void Replxx::set_incremental_highlighter_callback( incremental_highlighter_callback_t const& fn, void* userData ) {
+	_impl->set_incremental_highlighter_callback( fn, userData );
+}
+
+void Replxx::set_incremental_highlighter_view_callback( incremental_highlighter_view_callback_t const& fn, void* userData ) {
+	_impl->set_incremental_highlighter_view_callback( fn, userData );
+}
+
+int Replxx::matching_bracket( int pos ) {
+	return ( _impl->matching_bracket( pos ) );
+}
+
+bool Replxx::is_quoted( int pos ) {
+	return ( _impl->is_quoted( pos ) );
+}
+
 void Replxx::set_hint_callback( hint_callback_t const& fn, void* userData ) {
 	_impl->set_hint_callback( fn, userData );
 }
 
+void Replxx::set_hint_view_callback( hint_view_callback_t const& fn, void* userData ) {
+	_impl->set_hint_view_callback( fn, userData );
+}
+
+void Replxx::set_hint_collector_callback( hint_collector_callback_t const& fn, void* userData ) {
+	_impl->set_hint_collector_callback( fn, userData );
+}
+
+void Replxx::set_async_completion_callback( async_completion_callback_t const& fn, void* userData ) {
+	_impl->set_async_completion_callback( fn, userData );
+}
+
+void Replxx::set_async_hint_callback( async_hint_callback_t const& fn, void* userData ) {
+	_impl->set_async_hint_callback( fn, userData );
+}
+
+void Replxx::post_completions( int requestId, completions_t const& completions ) {
+	_impl->post_completions( requestId, completions );
+}
+
+void Replxx::post_hints( int requestId, hints_t const& hints, Color color ) {
+	_impl->post_hints( requestId, hints, color );
+}
+
+bool Replxx::is_request_current( int requestId ) const {
+	return ( _impl->is_request_current( requestId ) );
+}
+
+Replxx::Color Replxx::color_index( int index ) {
+	return ( static_cast<Color>( max( 0, min( index, 255 ) ) ) );
+}
+
+Replxx::Color Replxx::color_rgb( int red, int green, int blue ) {
+	red = max( 0, min( red, 255 ) );
+	green = max( 0, min( green, 255 ) );
+	blue = max( 0, min( blue, 255 ) );
+	return ( static_cast<Color>( Palette::RGB_FLAG | ( red << 16 ) | ( green << 8 ) | blue ) );
+}
+
 char const* Replxx::input( std::string const& prompt ) {
 	return ( _impl->input( prompt ) );
 }
@@ -487,6 +871,10 @@ int Replxx::history_load( std::string const& filename ) {
 	return ( _impl->history_load( filename ) );
 }
 
+int Replxx::history_sync( std::string const& filename ) {
+	return ( _impl->history_sync( filename ) );
+}
+
 int Replxx::history_size( void ) const {
 	return ( _impl->history_size() );
 }
@@ -507,6 +895,10 @@ void Replxx::set_special_prefixes( char const* specialPrefixes ) {
 	_impl->set_special_prefixes( specialPrefixes );
 }
 
+void Replxx::set_quote_characters( char const* quoteChars ) {
+	_impl->set_quote_characters( quoteChars );
+}
+
 void Replxx::set_max_line_size( int len ) {
 	_impl->set_max_line_size( len );
 }
@@ -515,6 +907,10 @@ void Replxx::set_max_hint_rows( int count ) {
 	_impl->set_max_hint_rows( count );
 }
 
+void Replxx::set_hint_delay( int milliseconds ) {
+	_impl->set_hint_delay( milliseconds );
+}
+
 void Replxx::set_double_tab_completion( bool val ) {
 	_impl->set_double_tab_completion( val );
 }
@@ -543,6 +939,10 @@ int Replxx::install_window_change_handler( void ) {
 	return ( _impl->install_window_change_handler() );
 }
 
+void Replxx::output_stats( long long& keystrokes_, long long& bytes_ ) const {
+	_impl->output_stats( keystrokes_, bytes_ );
+}
+
 int Replxx::print( char const* format_, ... ) {
 	::std::va_list ap;
 	va_start( ap, format_ );
@@ -557,6 +957,14 @@ int Replxx::print( char const* format_, ... ) {
 
 }
 
+ReplxxColor replxx_color_index( int index ) {
+	return ( static_cast<ReplxxColor>( replxx::Replxx::color_index( index ) ) );
+}
+
+ReplxxColor replxx_color_rgb( int red, int green, int blue ) {
+	return ( static_cast<ReplxxColor>( replxx::Replxx::color_rgb( red, green, blue ) ) );
+}
+
 ::Replxx* replxx_init() {
 	return ( reinterpret_cast<::Replxx*>( new replxx::Replxx::ReplxxImpl( nullptr, nullptr, nullptr ) ) );
 }
@@ -610,27 +1018,17 @@ int replxx_print( ::Replxx* replxx_, char const* format_, ... ) {
 	return ( replxx->print( buf.get(), size ) );
 }
 
-struct replxx_completions {
-	replxx::Replxx::completions_t data;
-};
-
-struct replxx_hints {
-	replxx::Replxx::hints_t data;
-};
-
-replxx::Replxx::completions_t completions_fwd( replxx_completion_callback_t fn, std::string const& input_, int breakPos_, void* userData ) {
-	replxx_completions completions;
-	fn( input_.c_str(), breakPos_, &completions, userData );
-	return ( completions.data );
+void completions_fwd( replxx_completion_callback_t fn, replxx::Replxx::InputView const& input_, int breakPos_, replxx::Replxx::Collector& completions_, void* userData ) {
+	fn( input_.data(), breakPos_, reinterpret_cast<replxx_completions*>( &completions_ ), userData );
 }
 
 /* Register a callback function to be called for tab-completion. */
 void replxx_set_completion_callback(::Replxx* replxx_, replxx_completion_callback_t* fn, void* userData) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
-	replxx->set_completion_callback( std::bind( &completions_fwd, fn, _1, _2, _3 ), userData );
+	replxx->set_completion_collector_callback( std::bind( &completions_fwd, fn, _1, _2, _3, _4 ), userData );
 }
 
-void highlighter_fwd( replxx_highlighter_callback_t fn, std::string const& input, replxx::Replxx::colors_t& colors, void* userData ) {
+void highlighter_fwd( replxx_highlighter_callback_t fn, replxx::Replxx::InputView const& input, replxx::Replxx::colors_t& colors, void* userData ) {
 	std::vector<ReplxxColor> colorsTmp( colors.size() );
 	std::transform(
 		colors.begin(),
@@ -640,7 +1038,7 @@ void highlighter_fwd( replxx_highlighter_callback_t fn, std::string const& input
 			return ( static_cast<ReplxxColor>( c ) );
 		}
 	);
-	fn( input.c_str(), colorsTmp.data(), colors.size(), userData );
+	fn( input.data(), colorsTmp.data(), colors.size(), userData );
 	std::transform(
 		colorsTmp.begin(),
 		colorsTmp.end(),
@@ -653,27 +1051,103 @@ void highlighter_fwd( replxx_highlighter_callback_t fn, std::string const& input
 
 void replxx_set_highlighter_callback( ::Replxx* replxx_, replxx_highlighter_callback_t* fn, void* userData ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
-	replxx->set_highlighter_callback( std::bind( &highlighter_fwd, fn, _1, _2, _3 ), userData );
+	replxx->set_highlighter_view_callback( std::bind( &highlighter_fwd, fn, _1, _2, _3 ), userData );
+}
+
+void incremental_highlighter_fwd(
+	replxx_incremental_highlighter_callback_t fn, replxx::Replxx::InputView const& input,
+	int pos, int removed, int inserted, replxx::Replxx::colors_t& colors, void* userData
+) {
+	std::vector<ReplxxColor> colorsTmp( colors.size() );
+	std::transform(
+		colors.begin(),
+		colors.end(),
+		colorsTmp.begin(),
+		[]( replxx::Replxx::Color c ) {
+			return ( static_cast<ReplxxColor>( c ) );
+		}
+	);
+	fn( input.data(), pos, removed, inserted, colorsTmp.data(), colors.size(), userData );
+	std::transform(
+		colorsTmp.begin(),
+		colorsTmp.end(),
+		colors.begin(),
+		[]( ReplxxColor c ) {
+			return ( static_cast<replxx::Replxx::Color>( c ) );
+		}
+	);
+}
+
+void replxx_set_incremental_highlighter_callback( ::Replxx* replxx_, replxx_incremental_highlighter_callback_t* fn, void* userData ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_incremental_highlighter_view_callback( std::bind( &incremental_highlighter_fwd, fn, _1, _2, _3, _4, _5, _6 ), userData );
+}
+
+int replxx_matching_bracket( ::Replxx* replxx_, int pos ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->matching_bracket( pos ) );
 }
 
-replxx::Replxx::hints_t hints_fwd( replxx_hint_callback_t fn, std::string const& input_, int breakPos_, replxx::Replxx::Color& color_, void* userData ) {
-	replxx_hints hints;
+int replxx_is_quoted( ::Replxx* replxx_, int pos ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->is_quoted( pos ) ? 1 : 0 );
+}
+
+void hints_fwd( replxx_hint_callback_t fn, replxx::Replxx::InputView const& input_, int breakPos_, replxx::Replxx::Collector& hints_, replxx::Replxx::Color& color_, void* userData ) {
 	ReplxxColor c( static_cast<ReplxxColor>( color_ ) );
-	fn( input_.c_str(), breakPos_, &hints, &c, userData );
-	return ( hints.data );
+	fn( input_.data(), breakPos_, reinterpret_cast<replxx_hints*>( &hints_ ), &c, userData );
 }
 
 void replxx_set_hint_callback( ::Replxx* replxx_, replxx_hint_callback_t* fn, void* userData ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
-	replxx->set_hint_callback( std::bind( &hints_fwd, fn, _1, _2, _3, _4 ), userData );
+	replxx->set_hint_collector_callback( std::bind( &hints_fwd, fn, _1, _2, _3, _4, _5 ), userData );
+}
+
+void async_fwd( replxx_async_callback_t fn, std::string const& input_, int breakPos_, int requestId_, void* userData ) {
+	fn( input_.c_str(), breakPos_, requestId_, userData );
+}
+
+void replxx_set_async_completion_callback( ::Replxx* replxx_, replxx_async_callback_t* fn, void* userData ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_async_completion_callback( std::bind( &async_fwd, fn, _1, _2, _3, _4 ), userData );
+}
+
+void replxx_set_async_hint_callback( ::Replxx* replxx_, replxx_async_callback_t* fn, void* userData ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_async_hint_callback( std::bind( &async_fwd, fn, _1, _2, _3, _4 ), userData );
+}
+
+void replxx_post_completions( ::Replxx* replxx_, int requestId, char const** completions, int count ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->post_completions( requestId, replxx::Replxx::completions_t( completions, completions + count ) );
+}
+
+void replxx_post_hints( ::Replxx* replxx_, int requestId, char const** hints, int count, ReplxxColor color ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->post_hints( requestId, replxx::Replxx::hints_t( hints, hints + count ), static_cast<replxx::Replxx::Color>( color ) );
+}
+
+int replxx_is_request_current( ::Replxx* replxx_, int requestId ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->is_request_current( requestId ) ? 1 : 0 );
 }
 
 void replxx_add_hint(replxx_hints* lh, const char* str) {
-	lh->data.emplace_back(str);
+	reinterpret_cast<replxx::Replxx::Collector*>( lh )->add( str );
 }
 
 void replxx_add_completion(replxx_completions* lc, const char* str) {
-	lc->data.emplace_back(str);
+	reinterpret_cast<replxx::Replxx::Collector*>( lc )->add( str );
+}
+
+void replxx_set_completion_words( ::Replxx* replxx_, char const** words, int count ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_completion_words( words, count );
+}
+
+void replxx_add_completion_words( ::Replxx* replxx_, char const** words, int count ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->add_completion_words( words, count );
 }
 
 void replxx_history_add( ::Replxx* replxx_, const char* line ) {
@@ -696,6 +1170,11 @@ void replxx_set_max_hint_rows( ::Replxx* replxx_, int count ) {
 	replxx->set_max_hint_rows( count );
 }
 
+void replxx_set_hint_delay( ::Replxx* replxx_, int milliseconds ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_hint_delay( milliseconds );
+}
+
 void replxx_set_word_break_characters( ::Replxx* replxx_, char const* breakChars_ ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
 	replxx->set_word_break_characters( breakChars_ );
@@ -706,6 +1185,11 @@ void replxx_set_special_prefixes( ::Replxx* replxx_, char const* specialPrefixes
 	replxx->set_special_prefixes( specialPrefixes_ );
 }
 
+void replxx_set_quote_characters( ::Replxx* replxx_, char const* quoteChars_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	replxx->set_quote_characters( quoteChars_ );
+}
+
 void replxx_set_double_tab_completion( ::Replxx* replxx_, int val ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
 	replxx->set_double_tab_completion( val ? true : false );
@@ -751,6 +1235,13 @@ int replxx_history_load( ::Replxx* replxx_, const char* filename ) {
 	return ( replxx->history_load( filename ) );
 }
 
+/* Append history entries added since last save, load or sync
+ * to the specified file. On success 0 is returned otherwise -1 is returned. */
+int replxx_history_sync( ::Replxx* replxx_, const char* filename ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	return ( replxx->history_sync( filename ) );
+}
+
 int replxx_history_size( ::Replxx* replxx_ ) {
 	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
 	return ( replxx->history_size() );
@@ -794,3 +1285,16 @@ int replxx_install_window_change_handler( ::Replxx* replxx_ ) {
 	return ( replxx->install_window_change_handler() );
 }
 
+void replxx_output_stats( ::Replxx* replxx_, long long* keystrokes_, long long* bytes_ ) {
+	replxx::Replxx::ReplxxImpl* replxx( reinterpret_cast<replxx::Replxx::ReplxxImpl*>( replxx_ ) );
+	long long keystrokes( 0 );
+	long long bytes( 0 );
+	replxx->output_stats( keystrokes, bytes );
+	if ( keystrokes_ ) {
+		*keystrokes_ = keystrokes;
+	}
+	if ( bytes_ ) {
+		*bytes_ = bytes;
+	}
+}
+
@@ -34,54 +34,105 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <mutex>
 
 #include "replxx.hxx"
 #include "history.hxx"
 #include "utfstring.hxx"
+#include "io.hxx"
+#include "palette.hxx"
+#include "dictionary.hxx"
 
 namespace replxx {
 
+class InputBuffer;
+
 class Replxx::ReplxxImpl {
-public:
-	typedef std::vector<Utf32String> completions_t;
-	typedef std::vector<Utf32String> hints_t;
-	typedef std::unique_ptr<char[]> input_buffer_t;
 private:
-	int _maxLineLength;
-	input_buffer_t _inputBuffer;
+	int _maxLineLength;      // 0 if not limited
+	std::string _inputBuffer;
 	History _history;
 	int _maxHintRows;
+	int _hintDelay;
 	char const* _breakChars;
 	char const* _specialPrefixes;
+	char const* _quoteChars;
 	int _completionCountCutoff;
 	bool _doubleTabCompletion;
 	bool _completeOnEmpty;
 	bool _beepOnAmbiguousCompletion;
 	bool _noColor;
-	Replxx::completion_callback_t _completionCallback;
-	Replxx::highlighter_callback_t _highlighterCallback;
-	Replxx::hint_callback_t _hintCallback;
+	// callbacks taking std::string are wrapped into ones taking a view,
+	// completion and hint callbacks into ones adding to a collector
+	Replxx::completion_collector_callback_t _completionCallback;
+	Replxx::highlighter_view_callback_t _highlighterCallback;
+	Replxx::incremental_highlighter_view_callback_t _incrementalHighlighterCallback;
+	Replxx::hint_collector_callback_t _hintCallback;
+	Replxx::async_completion_callback_t _asyncCompletionCallback;
+	Replxx::async_hint_callback_t _asyncHintCallback;
 	void* _completionUserdata;
 	void* _highlighterUserdata;
+	void* _incrementalHighlighterUserdata;
 	void* _hintUserdata;
+	void* _asyncCompletionUserdata;
+	void* _asyncHintUserdata;
+	mutable std::mutex _asyncMutex; // guards state of asynchronous requests below
+	int _lastRequestId;
+	int _completionRequestId;       // 0 when no completion request is awaited
+	bool _completionsPosted;
+	Replxx::Collector _postedCompletions;
+	int _hintRequestId;             // 0 when no hint request is active
+	std::string _hintInput;         // input of active hint request
+	bool _hintsPosted;
+	Replxx::Collector _postedHints;
+	Replxx::Color _postedHintColor;
+	Replxx::Collector _completions; // results of last completion request
+	Replxx::Collector _hints;       // results of last hint request
+	Dictionary _words;              // set with set_completion_words()
 	std::string _preloadedBuffer; // used with set_preload_buffer
 	std::string _errorMessage;
+	long long _keystrokeCount;
+	OutputBuffer _output;
+	Palette _palette;
+	std::unique_ptr<InputBuffer> _editor; // editing state, reused by consecutive input() calls
 public:
 	ReplxxImpl( FILE*, FILE*, FILE* );
+	~ReplxxImpl( void );
 	void set_completion_callback( Replxx::completion_callback_t const& fn, void* userData );
+	void set_completion_view_callback( Replxx::completion_view_callback_t const& fn, void* userData );
+	void set_completion_collector_callback( Replxx::completion_collector_callback_t const& fn, void* userData );
+	void set_completion_words( Replxx::completions_t const& words );
+	void set_completion_words( char const** words, int count );
+	void add_completion_words( Replxx::completions_t const& words );
+	void add_completion_words( char const** words, int count );
 	void set_highlighter_callback( Replxx::highlighter_callback_t const& fn, void* userData );
+	void set_highlighter_view_callback( Replxx::highlighter_view_callback_t const& fn, void* userData );
+	void set_incremental_highlighter_callback( Replxx::incremental_highlighter_callback_t const& fn, void* userData );
+	void set_incremental_highlighter_view_callback( Replxx::incremental_highlighter_view_callback_t const& fn, void* userData );
 	void set_hint_callback( Replxx::hint_callback_t const& fn, void* userData );
+	void set_hint_view_callback( Replxx::hint_view_callback_t const& fn, void* userData );
+	void set_hint_collector_callback( Replxx::hint_collector_callback_t const& fn, void* userData );
+	void set_async_completion_callback( Replxx::async_completion_callback_t const& fn, void* userData );
+	void set_async_hint_callback( Replxx::async_hint_callback_t const& fn, void* userData );
+	void post_completions( int requestId, Replxx::completions_t const& completions );
+	void post_hints( int requestId, Replxx::hints_t const& hints, Replxx::Color color );
+	bool is_request_current( int requestId ) const;
 	char const* input( std::string const& prompt );
 	void history_add( std::string const& line );
 	int history_save( std::string const& filename );
 	int history_load( std::string const& filename );
+	int history_sync( std::string const& filename );
 	std::string const& history_line( int index );
 	int history_size( void ) const;
 	void set_preload_buffer(std::string const& preloadText);
 	void set_word_break_characters( char const* wordBreakers );
 	void set_special_prefixes( char const* specialPrefixes );
+	void set_quote_characters( char const* quoteChars );
+	int matching_bracket( int pos );
+	bool is_quoted( int pos );
 	void set_max_line_size( int len );
 	void set_max_hint_rows( int count );
+	void set_hint_delay( int milliseconds );
 	void set_double_tab_completion( bool val );
 	void set_complete_on_empty( bool val );
 	void set_beep_on_ambiguous_completion( bool val );
@@ -89,20 +140,39 @@ public:
 	void set_max_history_size( int len );
 	void clear_screen( void );
 	int install_window_change_handler( void );
-	completions_t call_completer( std::string const& input, int breakPos ) const;
-	hints_t call_hinter( std::string const& input, int breakPos, Replxx::Color& color ) const;
-	void call_highlighter( std::string const& input, Replxx::colors_t& colors ) const;
+	void call_completer( Replxx::InputView const& input, int breakPos );
+	Replxx::Collector const& call_hinter( Replxx::InputView const& input, int breakPos, Replxx::Color& color );
+	void call_highlighter( Replxx::InputView const& input, Replxx::colors_t& colors ) const;
+	void call_incremental_highlighter( Replxx::InputView const& input, int pos, int removed, int inserted, Replxx::colors_t& colors ) const;
+	void request_completions( Replxx::InputView const& input, int breakPos );
+	bool posted_completions( void );
+	void cancel_completions( void );
+	void request_hints( Replxx::InputView const& input, int breakPos );
+	Replxx::Collector const& posted_hints( Replxx::Color& color );
+	void cancel_hints( void );
+	Replxx::Collector const& completions( void ) const {
+		return ( _completions );
+	}
 	History& history( void ) {
 		return ( _history );
 	}
 	bool has_hinter( void ) const {
-		return ( !! _hintCallback );
+		return ( !! _hintCallback || !! _asyncHintCallback || ( _words.count() > 0 ) );
+	}
+	bool has_async_hinter( void ) const {
+		return ( !! _asyncHintCallback );
 	}
 	bool has_completer( void ) const {
-		return ( !! _completionCallback );
+		return ( !! _completionCallback || !! _asyncCompletionCallback || ( _words.count() > 0 ) );
+	}
+	bool has_async_completer( void ) const {
+		return ( !! _asyncCompletionCallback );
 	}
 	bool has_highlighter( void ) const {
-		return ( !! _highlighterCallback );
+		return ( !! _highlighterCallback || !! _incrementalHighlighterCallback );
+	}
+	bool has_incremental_highlighter( void ) const {
+		return ( !! _incrementalHighlighterCallback );
 	}
 	bool no_color( void ) const {
 		return ( _noColor );
@@ -110,12 +180,18 @@ public:
 	int max_hint_rows( void ) const {
 		return ( _maxHintRows );
 	}
+	int hint_delay( void ) const {
+		return ( _hintDelay );
+	}
 	char const* break_chars( void ) const {
 		return ( _breakChars );
 	}
 	char const* special_prefixes( void ) const {
 		return ( _specialPrefixes );
 	}
+	char const* quote_characters( void ) const {
+		return ( _quoteChars );
+	}
 	bool beep_on_ambiguous_completion( void ) const {
 		return ( _beepOnAmbiguousCompletion );
 	}
@@ -129,7 +205,18 @@ public:
 		return ( _completionCountCutoff );
 	}
 	int print( char const* , int );
+	void output_stats( long long&, long long& ) const;
+	void note_keystroke( void ) {
+		++ _keystrokeCount;
+	}
+	OutputBuffer& output( void ) {
+		return ( _output );
+	}
+	Palette const& palette( void ) const {
+		return ( _palette );
+	}
 private:
+	void add_words( Replxx::InputView const& input, int breakPos, Replxx::Collector& results, bool hints );
 	ReplxxImpl( ReplxxImpl const& ) = delete;
 	ReplxxImpl& operator = ( ReplxxImpl const& ) = delete;
 };
@@ -2,77 +2,125 @@
 #define REPLXX_UTFSTRING_HXX_INCLUDED
 
 #include <cstring>
+#include <utility>
 
 #include "conversion.hxx"
 
 namespace replxx {
 
+/*! \brief UTF-32 string with inline storage for short contents.
+ *
+ * Strings shorter than INLINE_CAPACITY characters do not allocate.
+ * Storage always has room for a terminating zero after _length characters,
+ * and may be larger than that when the string is used as a buffer
+ * (see Utf32String(int) and initFromBuffer()).
+ */
 class Utf32String {
 public:
+	static size_t const INLINE_CAPACITY = 16;
 	Utf32String()
 		: _length( 0 )
+		, _capacity( 0 )
 		, _data( nullptr ) {
-		_data = new char32_t[1]();
+		allocate( 1 );
 	}
 
 	explicit Utf32String(const char* src)
 		: _length( 0 )
+		, _capacity( 0 )
 		, _data( nullptr ) {
 		size_t len = strlen(src);
-		_data = new char32_t[len + 1]();
+		allocate( len + 1 );
 		copyString8to32(_data, len + 1, _length, src);
 	}
 
 	explicit Utf32String(const char8_t* src)
 		: _length( 0 )
+		, _capacity( 0 )
 		, _data( nullptr ) {
 		size_t len = strlen(reinterpret_cast<const char*>(src));
-		_data = new char32_t[len + 1]();
+		allocate( len + 1 );
 		copyString8to32(_data, len + 1, _length, src);
 	}
 
 	explicit Utf32String(const char32_t* src)
 		: _length( 0 )
+		, _capacity( 0 )
 		, _data( nullptr ) {
 		for (_length = 0; src[_length] != 0; ++_length) {
 		}
-		_data = new char32_t[_length + 1]();
+		allocate( _length + 1 );
 		memcpy(_data, src, _length * sizeof(char32_t));
 	}
 
 	explicit Utf32String(const char32_t* src, int len)
 		: _length( len )
+		, _capacity( 0 )
 		, _data( nullptr ) {
-		_data = new char32_t[len + 1]();
+		allocate( len + 1 );
 		memcpy(_data, src, len * sizeof(char32_t));
 	}
 
+	/*! \brief Create zero filled buffer for \e len characters.
+	 */
 	explicit Utf32String(int len)
 		: _length( 0 )
+		, _capacity( 0 )
 		, _data( nullptr ) {
-		_data = new char32_t[len]();
+		allocate( len );
 	}
 
-	explicit Utf32String(const Utf32String& that)
+	Utf32String(const Utf32String& that)
 		: _length( 0 )
+		, _capacity( 0 )
 		, _data( nullptr ) {
-		_data = new char32_t[that._length + 1]();
+		allocate( that._length + 1 );
 		_length = that._length;
 		memcpy(_data, that._data, sizeof(char32_t) * _length);
 	}
 
+	Utf32String(Utf32String&& that) noexcept
+		: _length( 0 )
+		, _capacity( 0 )
+		, _data( nullptr ) {
+		take( that );
+	}
+
 	Utf32String& operator=(const Utf32String& that) {
 		if (this != &that) {
-			delete[] _data;
-			_data = new char32_t[that._length]();
+			if ( _capacity < ( that._length + 1 ) ) {
+				release();
+				allocate( that._length + 1 );
+			}
 			_length = that._length;
 			memcpy(_data, that._data, sizeof(char32_t) * _length);
+			_data[_length] = 0;
 		}
 
 		return *this;
 	}
 
-	~Utf32String() { delete[] _data; }
+	Utf32String& operator=(Utf32String&& that) noexcept {
+		if (this != &that) {
+			release();
+			take( that );
+		}
+		return *this;
+	}
+
+	~Utf32String() { release(); }
+
+	/*! \brief Replace contents with UTF-8 encoded \e src, reusing storage if it is large enough.
+	 */
+	void assign(const char* src) {
+		size_t len = strlen(src);
+		if ( _capacity < ( len + 1 ) ) {
+			release();
+			allocate( len + 1 );
+		}
+		_length = 0;
+		copyString8to32(_data, len + 1, _length, src);
+	}
 
 public:
 	char32_t* get() const { return _data; }
@@ -81,6 +129,8 @@ public:
 
 	size_t chars() const { return _length; }
 
+	size_t capacity() const { return _capacity; }
+
 	void initFromBuffer() {
 		for (_length = 0; _data[_length] != 0; ++_length) {
 		}
@@ -91,8 +141,47 @@ public:
 	char32_t& operator[](size_t pos) { return _data[pos]; }
 
  private:
+	bool is_inline( void ) const {
+		return ( _data == _buffer );
+	}
+	void allocate( size_t capacity_ ) {
+		if ( capacity_ <= INLINE_CAPACITY ) {
+			_data = _buffer;
+			_capacity = INLINE_CAPACITY;
+		} else {
+			_data = new char32_t[capacity_];
+			_capacity = capacity_;
+		}
+		memset( _data, 0, sizeof ( char32_t ) * _capacity );
+	}
+	void release( void ) {
+		if ( ! is_inline() ) {
+			delete[] _data;
+		}
+		_data = nullptr;
+		_capacity = 0;
+		_length = 0;
+	}
+	void take( Utf32String& that ) {
+		_length = that._length;
+		if ( that.is_inline() ) {
+			memcpy( _buffer, that._buffer, sizeof ( _buffer ) );
+			_data = _buffer;
+			_capacity = INLINE_CAPACITY;
+		} else {
+			_data = that._data;
+			_capacity = that._capacity;
+		}
+		that._data = that._buffer;
+		that._capacity = INLINE_CAPACITY;
+		that._length = 0;
+		that._buffer[0] = 0;
+	}
+
 	size_t _length;
+	size_t _capacity;
 	char32_t* _data;
+	char32_t _buffer[INLINE_CAPACITY];
 };
 
 class Utf8String {
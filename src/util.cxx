@@ -90,8 +90,8 @@ void calculateScreenPosition(int x, int y, int screenColumns,
  */
 int mk_wcswidth(const char32_t* pwcs, size_t n);
 
-int calculateColumnPosition(char32_t* buf32, int len) {
-	int width = mk_wcswidth(reinterpret_cast<const char32_t*>(buf32), len);
+int calculateColumnPosition(char32_t const* buf32, int len) {
+	int width = mk_wcswidth(buf32, len);
 	if (width == -1)
 		return len;
 	else
@@ -13,7 +13,7 @@ bool isCharacterAlphanumeric(char32_t testChar);
 
 void recomputeCharacterWidths( char32_t const* text, char* widths, int charCount );
 void calculateScreenPosition( int x, int y, int screenColumns, int charCount, int& xOut, int& yOut );
-int calculateColumnPosition( char32_t* buf32, int len );
+int calculateColumnPosition( char32_t const* buf32, int len );
 
 }
 
@@ -9,16 +9,6 @@ namespace replxx {
 
 WinAttributes WIN_ATTR;
 
-size_t OutputWin(char16_t* text16, char32_t* text32, size_t len32) {
-	size_t count16 = 0;
-
-	copyString32to16(text16, len32, &count16, text32, len32);
-	WriteConsoleW(GetStdHandle(STD_OUTPUT_HANDLE), text16,
-								static_cast<DWORD>(count16), nullptr, nullptr);
-
-	return count16;
-}
-
 template<typename T>
 T* HandleEsc(T* p, T* end) {
 	if (*p == '[') {
@@ -103,31 +93,6 @@ T* HandleEsc(T* p, T* end) {
 	return p;
 }
 
-size_t WinWrite32(char16_t* text16, char32_t* text32, size_t len32) {
-	char32_t* p = text32;
-	char32_t* q = p;
-	char32_t* e = text32 + len32;
-	size_t count16 = 0;
-
-	while (p < e) {
-		if (*p == 27) {
-			if (q < p) {
-				count16 += OutputWin(text16, q, p - q);
-			}
-
-			q = p = HandleEsc(p + 1, e);
-		} else {
-			++p;
-		}
-	}
-
-	if (q < p) {
-		count16 += OutputWin(text16, q, p - q);
-	}
-
-	return count16;
-}
-
 int win_print( char const* str_, int size_ ) {
 	int count( 0 );
 	char const* s( str_ );